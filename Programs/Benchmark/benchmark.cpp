@@ -0,0 +1,497 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/**
+ * @brief Constructs a benchmark of the given versions over the given data sets.
+ *
+ * @param variants The versions to run, with their options.
+ * @param dataSets The paths to the data set folders.
+ * @param repetitions The number of times each version is run on each data set.
+ */
+Benchmark::Benchmark(std::vector<Variant> variants, std::vector<std::string> dataSets, int repetitions)
+    : variants(std::move(variants)), dataSets(std::move(dataSets)), repetitions(repetitions)
+{
+}
+
+/**
+ * @brief Parses a version and its options from the command line.
+ *
+ * @param spec The version followed by its options, separated by colons.
+ * @return The variant, or std::nullopt if the version doesn't exist.
+ */
+std::optional<Variant> Benchmark::parseVariant(const std::string &spec)
+{
+    Variant variant;
+    variant.label = spec;
+
+    std::stringstream ss(spec);
+    std::string part;
+    std::getline(ss, variant.version, ':');
+    while (std::getline(ss, part, ':'))
+    {
+        variant.options.push_back(part);
+    }
+
+    const std::vector<std::string> versions = {"1", "2", "3", "4", "5", "5EC"};
+    if (std::find(versions.begin(), versions.end(), variant.version) == versions.end())
+    {
+        return std::nullopt;
+    }
+
+    return variant;
+}
+
+/**
+ * @brief Finds the default data sets: every Large-Data-Sets folder and Data-Set-1.
+ *
+ * @param dataRoot The folder holding Large-Data-Sets and Data-Set-1.
+ * @return The paths to the data set folders, in order of their number.
+ */
+std::vector<std::string> Benchmark::findDataSets(const std::string &dataRoot)
+{
+    // The large data sets are named DataSet-<number>--<procs>-procs
+    std::vector<std::pair<int, std::string>> largeDataSets;
+    std::string largeRoot = dataRoot + "/Large-Data-Sets";
+    if (std::filesystem::is_directory(largeRoot))
+    {
+        for (const auto &entry : std::filesystem::directory_iterator(largeRoot))
+        {
+            std::string name = entry.path().filename().string();
+            if (entry.is_directory() && name.rfind("DataSet-", 0) == 0 && name.find("-procs") != std::string::npos)
+            {
+                largeDataSets.push_back({std::atoi(name.c_str() + std::strlen("DataSet-")), entry.path().string()});
+            }
+        }
+    }
+    std::sort(largeDataSets.begin(), largeDataSets.end());
+
+    std::vector<std::string> dataSets;
+    for (const auto &dataSet : largeDataSets)
+    {
+        dataSets.push_back(dataSet.second);
+    }
+
+    if (std::filesystem::is_directory(dataRoot + "/Data-Set-1"))
+    {
+        dataSets.push_back(dataRoot + "/Data-Set-1");
+    }
+
+    return dataSets;
+}
+
+/**
+ * @brief Runs every version on every data set the requested number of times.
+ *
+ * The runs are interleaved by repetition, so a slow period on the machine affects
+ * every version rather than only the one that happened to be running.
+ */
+void Benchmark::run()
+{
+    // Orphaned descendants of a version are handed to the benchmark, so they are
+    // reaped (and accounted for) here instead of by init
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1) == -1)
+    {
+        perror("prctl failed");
+    }
+
+    for (int repetition = 0; repetition < this->repetitions; repetition++)
+    {
+        for (const auto &dataSet : this->dataSets)
+        {
+            for (const auto &variant : this->variants)
+            {
+                RunResult result = this->runOnce(variant, dataSet, repetition);
+                std::cout << "[" << repetition + 1 << "/" << this->repetitions << "] Version " << result.variant << " on "
+                          << result.dataSet << ": " << result.wallSeconds << " s";
+                if (result.exitCode != 0)
+                {
+                    std::cout << " (exit code " << result.exitCode << ")";
+                }
+                if (result.outputMatches.has_value() && !*result.outputMatches)
+                {
+                    std::cout << " (wrong output)";
+                }
+                std::cout << std::endl;
+
+                this->results.push_back(result);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Runs a version once on a data set and measures it.
+ *
+ * The version is launched directly rather than through its script, so the time it
+ * takes the script to find the highest process index isn't counted. The benchmark
+ * becomes a child subreaper, so every process the version starts is reaped here
+ * even if its parent doesn't wait for it. That way the CPU time and I/O of every
+ * process in the run are added to the benchmark's own counters.
+ *
+ * @param variant The version to run.
+ * @param dataSet The path to the data set folder.
+ * @param repetition The number of the repetition.
+ * @return The measurements of the run.
+ */
+RunResult Benchmark::runOnce(const Variant &variant, const std::string &dataSet, int repetition) const
+{
+    RunResult result = {};
+    result.variant = variant.label;
+    result.dataSet = std::filesystem::path(dataSet).filename().string();
+    result.repetition = repetition;
+
+    std::string outputFile = "./benchmark_output.c";
+    std::filesystem::remove(outputFile);
+
+    std::vector<std::string> args = Benchmark::buildCommand(variant, dataSet, outputFile);
+    std::vector<char *> c_args(args.size() + 1);
+    for (size_t i = 0; i < args.size(); i++)
+    {
+        c_args[i] = const_cast<char *>(args[i].c_str());
+    }
+    c_args[args.size()] = nullptr;
+
+    // Everything before the fork is the baseline the run is measured against
+    uint64_t readBefore, writtenBefore;
+    Benchmark::readIoCounters(readBefore, writtenBefore);
+    long processesBefore = Benchmark::readProcessesCreated();
+    auto start = std::chrono::steady_clock::now();
+
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        perror("fork failed");
+        exit(1);
+    }
+
+    if (pid == 0)
+    {
+        // Keep the versions' own progress messages out of the benchmark's output
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull != -1)
+        {
+            dup2(devNull, STDOUT_FILENO);
+            close(devNull);
+        }
+
+        execv(c_args[0], c_args.data());
+        perror("execv failed");
+        _exit(127);
+    }
+
+    // Wait for the version, then for anything it left behind
+    struct rusage usage = {};
+    struct rusage childUsage;
+    int status = 0;
+    pid_t reaped;
+    while ((reaped = wait4(-1, &status, 0, &childUsage)) != -1 || errno == EINTR)
+    {
+        if (reaped == -1)
+        {
+            continue;
+        }
+
+        usage.ru_utime.tv_sec += childUsage.ru_utime.tv_sec;
+        usage.ru_utime.tv_usec += childUsage.ru_utime.tv_usec;
+        usage.ru_stime.tv_sec += childUsage.ru_stime.tv_sec;
+        usage.ru_stime.tv_usec += childUsage.ru_stime.tv_usec;
+        usage.ru_maxrss = std::max(usage.ru_maxrss, childUsage.ru_maxrss);
+
+        if (reaped == pid)
+        {
+            result.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    long processesAfter = Benchmark::readProcessesCreated();
+    uint64_t readAfter, writtenAfter;
+    Benchmark::readIoCounters(readAfter, writtenAfter);
+
+    result.wallSeconds = std::chrono::duration<double>(end - start).count();
+    result.userSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    result.systemSeconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    result.peakRssKb = usage.ru_maxrss;
+    result.processes = processesBefore != -1 && processesAfter != -1 ? processesAfter - processesBefore : -1;
+    result.bytesRead = readAfter - readBefore;
+    result.bytesWritten = writtenAfter - writtenBefore;
+
+    std::string reference = Benchmark::findReference(dataSet);
+    if (!reference.empty())
+    {
+        result.outputMatches = result.exitCode == 0 && Benchmark::outputMatches(outputFile, reference);
+    }
+
+    std::filesystem::remove(outputFile);
+    return result;
+}
+
+/**
+ * @brief Builds the command line that runs a version on a data set.
+ *
+ * @param variant The version to run.
+ * @param dataSet The path to the data set folder.
+ * @param outputFile The path the version writes the program to.
+ * @return The arguments, starting with the path to the executable.
+ */
+std::vector<std::string> Benchmark::buildCommand(const Variant &variant, const std::string &dataSet, const std::string &outputFile)
+{
+    std::vector<std::string> args = {"./Executables/Version " + variant.version + "/version" + variant.version};
+
+    // Version 5 finds the highest process index itself, the others are told by their script
+    if (variant.version != "5")
+    {
+        args.push_back(std::to_string(Benchmark::findHighestProcessIdx(dataSet)));
+    }
+
+    args.push_back(dataSet);
+    args.push_back(outputFile);
+    args.insert(args.end(), variant.options.begin(), variant.options.end());
+    return args;
+}
+
+/**
+ * @brief Finds the highest process index among the data files, like the scripts do.
+ *
+ * @param dataSet The path to the data set folder.
+ * @return The highest process index, or 0 if no file starts with a number.
+ */
+int Benchmark::findHighestProcessIdx(const std::string &dataSet)
+{
+    int highestProcessIdx = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dataSet))
+    {
+        std::ifstream file(entry.path());
+        int processIdx;
+        if (file >> processIdx && processIdx > highestProcessIdx)
+        {
+            highestProcessIdx = processIdx;
+        }
+    }
+
+    return highestProcessIdx;
+}
+
+/**
+ * @brief Finds the reference output of a data set.
+ *
+ * @param dataSet The path to the data set folder.
+ * @return The path to combined.c in the folder, <folder>-combined.c or combined.c next
+ *         to it, or an empty string if there is none.
+ */
+std::string Benchmark::findReference(const std::string &dataSet)
+{
+    // Generated data sets keep theirs next to the folder as <folder>-combined.c
+    std::filesystem::path folder(dataSet);
+    std::filesystem::path generated = folder.parent_path() / (folder.filename().string() + "-combined.c");
+    for (const auto &candidate : {folder / "combined.c", generated, folder.parent_path() / "combined.c"})
+    {
+        if (std::filesystem::is_regular_file(candidate))
+        {
+            return candidate.string();
+        }
+    }
+
+    return "";
+}
+
+/**
+ * @brief Checks an output file against a reference output.
+ *
+ * The reference leaves an empty line for every missing line number, which the
+ * versions don't, so empty lines and carriage returns are ignored.
+ *
+ * @param outputFile The path to the output file.
+ * @param referenceFile The path to the reference output.
+ * @return True if the files have the same non-empty lines, false otherwise.
+ */
+bool Benchmark::outputMatches(const std::string &outputFile, const std::string &referenceFile)
+{
+    auto readLines = [](const std::string &path, std::vector<std::string> &lines)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+            if (!line.empty())
+            {
+                lines.push_back(line);
+            }
+        }
+        return true;
+    };
+
+    std::vector<std::string> output, reference;
+    return readLines(outputFile, output) && readLines(referenceFile, reference) && output == reference;
+}
+
+/**
+ * @brief Reads the number of processes created since boot from /proc/stat.
+ *
+ * @return The number of processes created, or -1 if it couldn't be read.
+ */
+long Benchmark::readProcessesCreated()
+{
+    // The counter covers every fork and clone on the machine, threads included, so it's
+    // only exact when nothing else is starting processes
+    std::ifstream stat("/proc/stat");
+    std::string key;
+    while (stat >> key)
+    {
+        if (key == "processes")
+        {
+            long processes;
+            return stat >> processes ? processes : -1;
+        }
+        stat.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Reads the bytes read and written by this process and its reaped children.
+ *
+ * @param bytesRead Set to the rchar counter of /proc/self/io.
+ * @param bytesWritten Set to the wchar counter of /proc/self/io.
+ */
+void Benchmark::readIoCounters(uint64_t &bytesRead, uint64_t &bytesWritten)
+{
+    // rchar and wchar count every byte passed to read and write, pipes included
+    bytesRead = 0;
+    bytesWritten = 0;
+
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    uint64_t value;
+    while (io >> key >> value)
+    {
+        if (key == "rchar:")
+        {
+            bytesRead = value;
+        }
+        else if (key == "wchar:")
+        {
+            bytesWritten = value;
+        }
+    }
+}
+
+/**
+ * @brief Writes the results of every run, and a summary per version and data set, as JSON.
+ *
+ * @param reportFile The path to the JSON file.
+ * @return True if the report was written, false otherwise.
+ */
+bool Benchmark::writeReport(const std::string &reportFile) const
+{
+    std::ofstream report(reportFile);
+    if (!report)
+    {
+        return false;
+    }
+
+    // Labels and folder names never hold quotes or backslashes, but escape them anyway
+    auto quote = [](const std::string &text)
+    {
+        std::string quoted = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                quoted.push_back('\\');
+            }
+            quoted.push_back(c);
+        }
+        return quoted + "\"";
+    };
+
+    auto matches = [](const std::optional<bool> &value)
+    {
+        return value.has_value() ? (*value ? "true" : "false") : "null";
+    };
+
+    report << "{\n  \"repetitions\": " << this->repetitions << ",\n  \"runs\": [";
+    for (size_t i = 0; i < this->results.size(); i++)
+    {
+        const RunResult &r = this->results[i];
+        report << (i == 0 ? "\n" : ",\n")
+               << "    {\"version\": " << quote(r.variant) << ", \"dataSet\": " << quote(r.dataSet)
+               << ", \"repetition\": " << r.repetition << ", \"exitCode\": " << r.exitCode
+               << ", \"wallSeconds\": " << r.wallSeconds << ", \"userSeconds\": " << r.userSeconds
+               << ", \"systemSeconds\": " << r.systemSeconds << ", \"peakRssKb\": " << r.peakRssKb
+               << ", \"processes\": " << r.processes << ", \"bytesRead\": " << r.bytesRead
+               << ", \"bytesWritten\": " << r.bytesWritten << ", \"outputMatches\": " << matches(r.outputMatches) << "}";
+    }
+
+    // One summary per version and data set, in the order they were run
+    report << "\n  ],\n  \"summary\": [";
+    bool first = true;
+    for (const auto &dataSet : this->dataSets)
+    {
+        std::string dataSetName = std::filesystem::path(dataSet).filename().string();
+        for (const auto &variant : this->variants)
+        {
+            std::vector<double> wall;
+            double user = 0, system = 0;
+            long peakRss = 0;
+            bool allSucceeded = true;
+            std::optional<bool> allMatch;
+            for (const auto &r : this->results)
+            {
+                if (r.variant != variant.label || r.dataSet != dataSetName)
+                {
+                    continue;
+                }
+
+                wall.push_back(r.wallSeconds);
+                user += r.userSeconds;
+                system += r.systemSeconds;
+                peakRss = std::max(peakRss, r.peakRssKb);
+                allSucceeded = allSucceeded && r.exitCode == 0;
+                if (r.outputMatches.has_value())
+                {
+                    allMatch = allMatch.value_or(true) && *r.outputMatches;
+                }
+            }
+
+            if (wall.empty())
+            {
+                continue;
+            }
+
+            std::sort(wall.begin(), wall.end());
+            double median = wall.size() % 2 == 1 ? wall[wall.size() / 2] : (wall[wall.size() / 2 - 1] + wall[wall.size() / 2]) / 2;
+
+            report << (first ? "\n" : ",\n")
+                   << "    {\"version\": " << quote(variant.label) << ", \"dataSet\": " << quote(dataSetName)
+                   << ", \"runs\": " << wall.size() << ", \"medianWallSeconds\": " << median
+                   << ", \"minWallSeconds\": " << wall.front() << ", \"maxWallSeconds\": " << wall.back()
+                   << ", \"meanUserSeconds\": " << user / wall.size() << ", \"meanSystemSeconds\": " << system / wall.size()
+                   << ", \"peakRssKb\": " << peakRss << ", \"allSucceeded\": " << (allSucceeded ? "true" : "false")
+                   << ", \"outputMatches\": " << matches(allMatch) << "}";
+            first = false;
+        }
+    }
+    report << "\n  ]\n}\n";
+
+    return static_cast<bool>(report);
+}
@@ -0,0 +1,167 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+
+/**
+ * @struct Variant
+ * @brief A version of the program to benchmark, along with any options passed to it.
+ *
+ * Written on the command line as the version followed by its options, separated by
+ * colons, e.g. "5:--engine=threads".
+ */
+struct Variant
+{
+    std::string label;
+    std::string version;
+    std::vector<std::string> options;
+};
+
+/**
+ * @struct RunResult
+ * @brief What was measured during a single run of a version on a data set.
+ */
+struct RunResult
+{
+    std::string variant;
+    std::string dataSet;
+    int repetition;
+    int exitCode;
+    double wallSeconds;
+    double userSeconds;
+    double systemSeconds;
+    long peakRssKb;
+    long processes;
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+    std::optional<bool> outputMatches;
+};
+
+class Benchmark
+{
+public:
+    /**
+     * @brief Constructs a benchmark of the given versions over the given data sets.
+     *
+     * @param variants The versions to run, with their options.
+     * @param dataSets The paths to the data set folders.
+     * @param repetitions The number of times each version is run on each data set.
+     */
+    Benchmark(std::vector<Variant> variants, std::vector<std::string> dataSets, int repetitions);
+
+    /**
+     * @brief Parses a version and its options from the command line.
+     *
+     * @param spec The version followed by its options, separated by colons.
+     * @return The variant, or std::nullopt if the version doesn't exist.
+     */
+    static std::optional<Variant> parseVariant(const std::string &spec);
+
+    /**
+     * @brief Finds the default data sets: every Large-Data-Sets folder and Data-Set-1.
+     *
+     * @param dataRoot The folder holding Large-Data-Sets and Data-Set-1.
+     * @return The paths to the data set folders, in order of their number.
+     */
+    static std::vector<std::string> findDataSets(const std::string &dataRoot);
+
+    /**
+     * @brief Runs every version on every data set the requested number of times.
+     *
+     * The runs are interleaved by repetition, so a slow period on the machine affects
+     * every version rather than only the one that happened to be running.
+     */
+    void run();
+
+    /**
+     * @brief Writes the results of every run, and a summary per version and data set, as JSON.
+     *
+     * @param reportFile The path to the JSON file.
+     * @return True if the report was written, false otherwise.
+     */
+    bool writeReport(const std::string &reportFile) const;
+
+private:
+    std::vector<Variant> variants;
+    std::vector<std::string> dataSets;
+    int repetitions;
+    std::vector<RunResult> results;
+
+    /**
+     * @brief Runs a version once on a data set and measures it.
+     *
+     * The version is launched directly rather than through its script, so the time it
+     * takes the script to find the highest process index isn't counted. The benchmark
+     * becomes a child subreaper, so every process the version starts is reaped here
+     * even if its parent doesn't wait for it. That way the CPU time and I/O of every
+     * process in the run are added to the benchmark's own counters.
+     *
+     * @param variant The version to run.
+     * @param dataSet The path to the data set folder.
+     * @param repetition The number of the repetition.
+     * @return The measurements of the run.
+     */
+    RunResult runOnce(const Variant &variant, const std::string &dataSet, int repetition) const;
+
+    /**
+     * @brief Builds the command line that runs a version on a data set.
+     *
+     * @param variant The version to run.
+     * @param dataSet The path to the data set folder.
+     * @param outputFile The path the version writes the program to.
+     * @return The arguments, starting with the path to the executable.
+     */
+    static std::vector<std::string> buildCommand(const Variant &variant, const std::string &dataSet, const std::string &outputFile);
+
+    /**
+     * @brief Finds the highest process index among the data files, like the scripts do.
+     *
+     * @param dataSet The path to the data set folder.
+     * @return The highest process index, or 0 if no file starts with a number.
+     */
+    static int findHighestProcessIdx(const std::string &dataSet);
+
+    /**
+     * @brief Finds the reference output of a data set.
+     *
+     * @param dataSet The path to the data set folder.
+     * @return The path to combined.c in the folder, <folder>-combined.c or combined.c next
+     *         to it, or an empty string if there is none.
+     */
+    static std::string findReference(const std::string &dataSet);
+
+    /**
+     * @brief Checks an output file against a reference output.
+     *
+     * The reference leaves an empty line for every missing line number, which the
+     * versions don't, so empty lines and carriage returns are ignored.
+     *
+     * @param outputFile The path to the output file.
+     * @param referenceFile The path to the reference output.
+     * @return True if the files have the same non-empty lines, false otherwise.
+     */
+    static bool outputMatches(const std::string &outputFile, const std::string &referenceFile);
+
+    /**
+     * @brief Reads the number of processes created since boot from /proc/stat.
+     *
+     * @return The number of processes created, or -1 if it couldn't be read.
+     */
+    static long readProcessesCreated();
+
+    /**
+     * @brief Reads the bytes read and written by this process and its reaped children.
+     *
+     * @param bytesRead Set to the rchar counter of /proc/self/io.
+     * @param bytesWritten Set to the wchar counter of /proc/self/io.
+     */
+    static void readIoCounters(uint64_t &bytesRead, uint64_t &bytesWritten);
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include "benchmark.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <reportFile> [--reps=N] [--versions=1,2,3,4,5,5EC] [--data=<dataSetFolder>]..." << std::endl;
+        return 26;
+    }
+
+    // First argument contains the path to the JSON report
+    std::string reportFile = argv[1];
+
+    // Optional arguments select how many times each version is run, which versions are
+    // run (each one can be followed by options for it, e.g. 5:--engine=threads), and which
+    // data sets they are run on. By default every version is run three times on every
+    // large data set and Data-Set-1.
+    int repetitions = 3;
+    std::string versions = "1,2,3,4,5,5EC";
+    std::vector<std::string> dataSets;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option.rfind("--reps=", 0) == 0)
+        {
+            try
+            {
+                repetitions = std::stoi(option.substr(std::string("--reps=").size()));
+            }
+            catch (const std::exception &)
+            {
+                repetitions = -1;
+            }
+
+            if (repetitions < 1)
+            {
+                std::cerr << "Invalid number of repetitions: " << option << std::endl;
+                return 29;
+            }
+        }
+        else if (option.rfind("--versions=", 0) == 0)
+        {
+            versions = option.substr(std::string("--versions=").size());
+        }
+        else if (option.rfind("--data=", 0) == 0)
+        {
+            dataSets.push_back(option.substr(std::string("--data=").size()));
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 28;
+        }
+    }
+
+    std::vector<Variant> variants;
+    std::stringstream ss(versions);
+    std::string spec;
+    while (std::getline(ss, spec, ','))
+    {
+        std::optional<Variant> variant = Benchmark::parseVariant(spec);
+        if (!variant.has_value())
+        {
+            std::cerr << "Unknown version: " << spec << std::endl;
+            return 28;
+        }
+        variants.push_back(*variant);
+    }
+
+    if (dataSets.empty())
+    {
+        dataSets = Benchmark::findDataSets("./Data/Data-Sets/Data-Sets");
+    }
+
+    if (variants.empty() || dataSets.empty())
+    {
+        std::cerr << "Nothing to benchmark" << std::endl;
+        return 2;
+    }
+
+    Benchmark benchmark(variants, dataSets, repetitions);
+    benchmark.run();
+
+    if (!benchmark.writeReport(reportFile))
+    {
+        std::cerr << "Failed to write the report to " << reportFile << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote the report to " << reportFile << std::endl;
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include "generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <numeric>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief Constructs a generator that splits a source file into fragments.
+ *
+ * @param sourceLines The lines of the source file, without their line endings.
+ * @param options The knobs of the data set.
+ */
+Generator::Generator(std::vector<std::string> sourceLines, GeneratorOptions options)
+    : sourceLines(std::move(sourceLines)), options(options), rng(options.seed)
+{
+}
+
+/**
+ * @brief Reads the lines of a source file.
+ *
+ * @param sourceFile The path to the source file.
+ * @param lines Filled with the lines of the file, without their line endings.
+ * @return True if the file could be read, false otherwise.
+ */
+bool Generator::readSourceLines(const std::string &sourceFile, std::vector<std::string> &lines)
+{
+    std::ifstream file(sourceFile);
+    if (!file)
+    {
+        return false;
+    }
+
+    // Carriage returns are only added back by the CRLF knob
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        lines.push_back(line);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Parses a line length distribution from the command line.
+ *
+ * @param spec "source", "fixed:N", "uniform:MIN:MAX" or "normal:MEAN:STDDEV".
+ * @return The distribution, or std::nullopt if it isn't valid.
+ */
+std::optional<LineLength> Generator::parseLineLength(const std::string &spec)
+{
+    LineLength lineLength;
+    std::vector<std::string> parts;
+    std::stringstream ss(spec);
+    std::string part;
+    while (std::getline(ss, part, ':'))
+    {
+        parts.push_back(part);
+    }
+
+    if (parts.empty())
+    {
+        return std::nullopt;
+    }
+
+    lineLength.distribution = parts[0];
+    size_t expectedParts = lineLength.distribution == "source" ? 1 : lineLength.distribution == "fixed" ? 2
+                                                                                                       : 3;
+    if (parts.size() != expectedParts ||
+        (lineLength.distribution != "source" && lineLength.distribution != "fixed" &&
+         lineLength.distribution != "uniform" && lineLength.distribution != "normal"))
+    {
+        return std::nullopt;
+    }
+
+    try
+    {
+        if (parts.size() > 1)
+        {
+            lineLength.first = std::stod(parts[1]);
+        }
+        if (parts.size() > 2)
+        {
+            lineLength.second = std::stod(parts[2]);
+        }
+    }
+    catch (const std::exception &)
+    {
+        return std::nullopt;
+    }
+
+    if (lineLength.first < 0 || lineLength.second < 0 ||
+        (lineLength.distribution == "uniform" && lineLength.second < lineLength.first))
+    {
+        return std::nullopt;
+    }
+
+    return lineLength;
+}
+
+/**
+ * @brief Splits the fragments between the process indices.
+ *
+ * Process index i gets a share of the fragments proportional to 1 / (i + 1)^skew, so
+ * a skew of 0 splits them evenly and larger skews pile them onto the first indices.
+ * Every index gets at least one fragment as long as there are enough fragments.
+ *
+ * @return The number of fragments of every process index.
+ */
+std::vector<size_t> Generator::splitFragments() const
+{
+    size_t numProcesses = this->options.numProcesses;
+    size_t numFragments = this->options.numFragments;
+    std::vector<size_t> counts(numProcesses, 0);
+
+    // With fewer fragments than process indices, the first indices get one each
+    if (numFragments <= numProcesses)
+    {
+        std::fill(counts.begin(), counts.begin() + numFragments, 1);
+        return counts;
+    }
+
+    std::vector<double> weights(numProcesses);
+    for (size_t i = 0; i < numProcesses; i++)
+    {
+        weights[i] = 1.0 / std::pow(static_cast<double>(i + 1), this->options.skew);
+    }
+    double totalWeight = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+    // Every index gets one fragment, the rest are split by weight and whatever the
+    // rounding left over goes to the indices that lost the most to it
+    size_t remaining = numFragments - numProcesses;
+    std::vector<std::pair<double, size_t>> leftovers(numProcesses);
+    size_t assigned = 0;
+    for (size_t i = 0; i < numProcesses; i++)
+    {
+        double share = remaining * weights[i] / totalWeight;
+        size_t whole = static_cast<size_t>(share);
+        counts[i] = 1 + whole;
+        assigned += whole;
+        leftovers[i] = {share - whole, i};
+    }
+
+    std::sort(leftovers.begin(), leftovers.end(), [](const auto &a, const auto &b)
+              { return a.first != b.first ? a.first > b.first : a.second < b.second; });
+    for (size_t i = 0; assigned < remaining; i++, assigned++)
+    {
+        counts[leftovers[i % numProcesses].second]++;
+    }
+
+    return counts;
+}
+
+/**
+ * @brief Writes every fragment to its own file in the output folder.
+ *
+ * The line numbers count through the whole program, so the fragments of process
+ * index 0 come first, then those of index 1, and so on. When more fragments are
+ * asked for than the source file has lines, the source file is repeated. The files
+ * are named f1.txt, f2.txt, ... in a random order so the order of the folder says
+ * nothing about the order of the program.
+ *
+ * The program the versions should rebuild is written to referenceFile, with each
+ * fragment's code followed by a newline.
+ *
+ * @param outputFolder The folder to write the fragments to. It is created if needed, and
+ * must be empty if it already exists.
+ * @param referenceFile The path to write the expected output to.
+ * @return True if every file was written, false otherwise.
+ */
+bool Generator::generate(const std::string &outputFolder, const std::string &referenceFile)
+{
+    // Fragments left over from an earlier, larger run would end up in the data set
+    std::error_code error;
+    if (std::filesystem::is_directory(outputFolder, error) && !std::filesystem::is_empty(outputFolder, error))
+    {
+        std::cerr << "Output folder " << outputFolder << " is not empty" << std::endl;
+        return false;
+    }
+
+    std::filesystem::create_directories(outputFolder, error);
+    if (error)
+    {
+        std::cerr << "Failed to create " << outputFolder << ": " << error.message() << std::endl;
+        return false;
+    }
+
+    std::ofstream reference(referenceFile, std::ios::binary);
+    if (!reference)
+    {
+        std::cerr << "Failed to open " << referenceFile << std::endl;
+        return false;
+    }
+
+    // Shuffle the file names so the folder isn't listed in program order
+    std::vector<size_t> fileNames(this->options.numFragments);
+    std::iota(fileNames.begin(), fileNames.end(), 1);
+    std::shuffle(fileNames.begin(), fileNames.end(), this->rng);
+
+    std::vector<size_t> counts = this->splitFragments();
+    std::bernoulli_distribution crlf(this->options.crlfFraction);
+
+    size_t fragmentIdx = 0;
+    std::string contents;
+    for (int processIdx = 0; processIdx < this->options.numProcesses; processIdx++)
+    {
+        for (size_t i = 0; i < counts[processIdx]; i++, fragmentIdx++)
+        {
+            // Some data sets come from Windows, where the code keeps a trailing carriage return
+            std::string code = this->makeCode(this->sourceLines[fragmentIdx % this->sourceLines.size()]);
+            if (crlf(this->rng))
+            {
+                code.push_back('\r');
+            }
+
+            contents = std::to_string(processIdx) + " " + std::to_string(fragmentIdx + 1) + " " + code + "\n";
+            reference << code << "\n";
+
+            std::string path = outputFolder + "/f" + std::to_string(fileNames[fragmentIdx]) + ".txt";
+            int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd == -1)
+            {
+                perror(("Failed to create " + path).c_str());
+                return false;
+            }
+
+            bool written = write(fd, contents.data(), contents.size()) == static_cast<ssize_t>(contents.size());
+            close(fd);
+            if (!written)
+            {
+                std::cerr << "Failed to write " << path << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return static_cast<bool>(reference);
+}
+
+/**
+ * @brief Makes the code of a fragment from a source line.
+ *
+ * @param sourceLine The source line the fragment is taken from.
+ * @return The code, cut or padded to a length drawn from the line length distribution.
+ */
+std::string Generator::makeCode(const std::string &sourceLine)
+{
+    const LineLength &lineLength = this->options.lineLength;
+    if (lineLength.distribution == "source")
+    {
+        return sourceLine;
+    }
+
+    double drawn;
+    if (lineLength.distribution == "fixed")
+    {
+        drawn = lineLength.first;
+    }
+    else if (lineLength.distribution == "uniform")
+    {
+        drawn = std::uniform_int_distribution<long>(std::lround(lineLength.first), std::lround(lineLength.second))(this->rng);
+    }
+    else
+    {
+        drawn = std::normal_distribution<double>(lineLength.first, lineLength.second)(this->rng);
+    }
+    size_t length = static_cast<size_t>(std::max(0L, std::lround(drawn)));
+
+    if (sourceLine.size() >= length)
+    {
+        return sourceLine.substr(0, length);
+    }
+
+    // Pad with a comment so the line still compiles when it was short enough to begin with
+    std::string code = sourceLine;
+    if (length - code.size() >= 3)
+    {
+        code += " //";
+    }
+    code.resize(length, code.size() >= sourceLine.size() + 3 ? 'x' : ' ');
+    return code;
+}
@@ -0,0 +1,112 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <optional>
+
+/**
+ * @struct LineLength
+ * @brief How long the code of each generated fragment is.
+ *
+ * "source" keeps the source lines as they are. "fixed:N", "uniform:MIN:MAX" and
+ * "normal:MEAN:STDDEV" pick a length for every fragment, and the source line is cut
+ * to that length or padded with a trailing comment.
+ */
+struct LineLength
+{
+    std::string distribution = "source";
+    double first = 0;
+    double second = 0;
+};
+
+/**
+ * @struct GeneratorOptions
+ * @brief The knobs of a generated data set.
+ */
+struct GeneratorOptions
+{
+    size_t numFragments = 0;
+    int numProcesses = 8;
+    double skew = 0;
+    LineLength lineLength;
+    double crlfFraction = 0;
+    unsigned int seed = 1;
+};
+
+class Generator
+{
+public:
+    /**
+     * @brief Constructs a generator that splits a source file into fragments.
+     *
+     * @param sourceLines The lines of the source file, without their line endings.
+     * @param options The knobs of the data set.
+     */
+    Generator(std::vector<std::string> sourceLines, GeneratorOptions options);
+
+    /**
+     * @brief Reads the lines of a source file.
+     *
+     * @param sourceFile The path to the source file.
+     * @param lines Filled with the lines of the file, without their line endings.
+     * @return True if the file could be read, false otherwise.
+     */
+    static bool readSourceLines(const std::string &sourceFile, std::vector<std::string> &lines);
+
+    /**
+     * @brief Parses a line length distribution from the command line.
+     *
+     * @param spec "source", "fixed:N", "uniform:MIN:MAX" or "normal:MEAN:STDDEV".
+     * @return The distribution, or std::nullopt if it isn't valid.
+     */
+    static std::optional<LineLength> parseLineLength(const std::string &spec);
+
+    /**
+     * @brief Splits the fragments between the process indices.
+     *
+     * Process index i gets a share of the fragments proportional to 1 / (i + 1)^skew, so
+     * a skew of 0 splits them evenly and larger skews pile them onto the first indices.
+     * Every index gets at least one fragment as long as there are enough fragments.
+     *
+     * @return The number of fragments of every process index.
+     */
+    std::vector<size_t> splitFragments() const;
+
+    /**
+     * @brief Writes every fragment to its own file in the output folder.
+     *
+     * The line numbers count through the whole program, so the fragments of process
+     * index 0 come first, then those of index 1, and so on. When more fragments are
+     * asked for than the source file has lines, the source file is repeated. The files
+     * are named f1.txt, f2.txt, ... in a random order so the order of the folder says
+     * nothing about the order of the program.
+     *
+     * The program the versions should rebuild is written to referenceFile, with each
+     * fragment's code followed by a newline.
+     *
+     * @param outputFolder The folder to write the fragments to. It is created if needed, and
+     * must be empty if it already exists.
+     * @param referenceFile The path to write the expected output to.
+     * @return True if every file was written, false otherwise.
+     */
+    bool generate(const std::string &outputFolder, const std::string &referenceFile);
+
+private:
+    std::vector<std::string> sourceLines;
+    GeneratorOptions options;
+    std::mt19937_64 rng;
+
+    /**
+     * @brief Makes the code of a fragment from a source line.
+     *
+     * @param sourceLine The source line the fragment is taken from.
+     * @return The code, cut or padded to a length drawn from the line length distribution.
+     */
+    std::string makeCode(const std::string &sourceLine);
+};
+
+#endif // GENERATOR_H
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "generator.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <sourceFile> <outputFolder> [--fragments=N] [--procs=N] [--skew=S] "
+                  << "[--line-length=source|fixed:N|uniform:MIN:MAX|normal:MEAN:STDDEV] [--crlf=FRACTION] [--seed=N]" << std::endl;
+        return 26;
+    }
+
+    // First argument contains the path to the source file the fragments are cut from
+    std::string sourceFile = argv[1];
+
+    // Second argument contains the path to the folder the fragments are written to
+    std::string outputFolder = argv[2];
+    while (outputFolder.size() > 1 && outputFolder.back() == '/')
+    {
+        outputFolder.pop_back();
+    }
+
+    std::vector<std::string> sourceLines;
+    if (!Generator::readSourceLines(sourceFile, sourceLines) || sourceLines.empty())
+    {
+        std::cerr << "Source file does not exist or is empty: " << sourceFile << std::endl;
+        return 2;
+    }
+
+    // Optional arguments shape the data set. By default there is one fragment per line of
+    // the source file, split evenly between 8 process indices, with the source lines kept
+    // as they are and no carriage returns.
+    GeneratorOptions options;
+    options.numFragments = sourceLines.size();
+    for (int i = 3; i < argc; i++)
+    {
+        std::string option = argv[i];
+        std::string value = option.substr(option.find('=') + 1);
+        try
+        {
+            if (option.rfind("--fragments=", 0) == 0)
+            {
+                long long numFragments = std::stoll(value);
+                if (numFragments < 1)
+                {
+                    throw std::invalid_argument(option);
+                }
+                options.numFragments = numFragments;
+            }
+            else if (option.rfind("--procs=", 0) == 0)
+            {
+                options.numProcesses = std::stoi(value);
+                if (options.numProcesses < 1)
+                {
+                    throw std::invalid_argument(option);
+                }
+            }
+            else if (option.rfind("--skew=", 0) == 0)
+            {
+                options.skew = std::stod(value);
+                if (options.skew < 0)
+                {
+                    throw std::invalid_argument(option);
+                }
+            }
+            else if (option.rfind("--line-length=", 0) == 0)
+            {
+                std::optional<LineLength> lineLength = Generator::parseLineLength(value);
+                if (!lineLength.has_value())
+                {
+                    throw std::invalid_argument(option);
+                }
+                options.lineLength = *lineLength;
+            }
+            else if (option.rfind("--crlf=", 0) == 0)
+            {
+                options.crlfFraction = std::stod(value);
+                if (options.crlfFraction < 0 || options.crlfFraction > 1)
+                {
+                    throw std::invalid_argument(option);
+                }
+            }
+            else if (option.rfind("--seed=", 0) == 0)
+            {
+                options.seed = std::stoul(value);
+            }
+            else
+            {
+                std::cerr << "Unknown option: " << option << std::endl;
+                return 28;
+            }
+        }
+        catch (const std::exception &)
+        {
+            std::cerr << "Invalid option: " << option << std::endl;
+            return 29;
+        }
+    }
+
+    // The expected output goes next to the folder rather than in it, where it would be
+    // read as a data file
+    std::string referenceFile = outputFolder + "-combined.c";
+
+    Generator generator(sourceLines, options);
+    if (!generator.generate(outputFolder, referenceFile))
+    {
+        return 1;
+    }
+
+    std::cout << "Wrote " << options.numFragments << " fragments for " << options.numProcesses << " processes to "
+              << outputFolder << " and the expected output to " << referenceFile << std::endl;
+    return 0;
+}
@@ -1,8 +1,8 @@
 #include "client.h"
 #include "testing.h"
+#include "communications.h"
 
 std::string EXECUTABLES_PATH = "./Executables/Version 5/";
-unsigned int PIPE_CAPACITY = 4096;
 
 /**
  * Constructs a client that represents a "distributor" process, whose job is to
@@ -13,7 +13,7 @@ unsigned int PIPE_CAPACITY = 4096;
 Client::Client(int clientIdx)
 {
     this->clientIdx = clientIdx;
-    DEBUG_FILE("Client id " + std::to_string(clientIdx) + " created.", "debug.log");
+    DEBUG_LOG(LogLevel::Debug, "Client id " + std::to_string(clientIdx) + " created.", "debug.log");
 }
 
 /**
@@ -29,7 +29,7 @@ Client::Client(int clientIdx, int filesStartIdx, int filesEndIdx)
     this->clientIdx = clientIdx;
     this->filesStartIdx = filesStartIdx;
     this->filesEndIdx = filesEndIdx;
-    DEBUG_FILE("Client id " + std::to_string(clientIdx) + " created.", "debug_ch_" + std::to_string(clientIdx) + ".log");
+    DEBUG_LOG(LogLevel::Debug, "Client id " + std::to_string(clientIdx) + " created.", "debug_ch_" + std::to_string(clientIdx) + ".log");
 }
 
 /**
@@ -95,11 +95,25 @@ void Client::setFilesEndIdx(int endIdx)
 /**
  * Adds a file to the list of files.
  *
+ * The file is read once here and its parsed line is cached alongside the path so the
+ * processor never has to open the file again. A file that can no longer be read, or that
+ * has a negative process index, is skipped.
+ *
  * @param file The file to add to the list.
  */
 void Client::addFile(const std::string &file)
 {
+    // The file may have changed or been removed since the client that reported it read it
+    FragmentView fragment;
+    if (!this->getDataFileContents(file, fragment) || fragment.processIdx < 0)
+    {
+        std::cerr << "Skipping unreadable or invalid data file: " << file << std::endl;
+        DEBUG_WARNING("Skipping unreadable or invalid data file: " + file, "debug.log");
+        return;
+    }
+
     this->verifiedFiles.push_back(file);
+    this->verifiedLines.append(fragment.processIdx, fragment.lineNum, fragment.code);
 }
 
 /**
@@ -146,58 +160,146 @@ void Client::setFiles(std::vector<std::string> files)
  * @brief Verifies the distribution of data files among clients and sneds the
  * incorrectly distributed files to the server for redistribution.
  *
- * This function reads the process index for each file to determine which client
- * it belongs to. If the file belongs to the current client, it is added to the
- * list of verified files. If not, the correct client index and file path are
- * written to the pipe so the server can send the file to the correct client.
+ * This function splits the client's subset of files with partitionDataFiles. Once every file
+ * has been checked, the whole report of incorrectly distributed files is written to the
+ * pipe as a single frame so the server can send the files to the correct clients. The
+ * frame also tells the server this client is done verifying.
  *
  * @param numClients The number of clients.
- * @param files A vector of strings containing the subset of files to be verified
- * and distributed by the current client.
+ * @param numBlocks The number of blocks of code, one per process index.
+ * @param manifest The manifest holding the paths of all the data files.
  * @param writePipeFd The file descriptor for the write end of the pipe.
  */
-void Client::verifyDataFilesDistribution(int numClients, const std::vector<std::string> &files, int writePipeFd)
+void Client::verifyDataFilesDistribution(int numClients, int numBlocks, const Manifest &manifest, int writePipeFd)
 {
+    PhaseTimer timer("verifyDataFilesDistribution");
+
     std::string debugChFile = "debug_ch_" + std::to_string(this->clientIdx) + ".log";
-    DEBUG_FILE("Verifying data files for client " + std::to_string(this->clientIdx), debugChFile);
 
-    // Go through the specified subset of files and add them to the appropriate client's list
-    for (const auto &file : files)
+    // The files that belong to other clients, sent to the server in one go
+    std::vector<MisplacedFile> misplacedFiles = this->partitionDataFiles(numClients, numBlocks, manifest);
+
+    // Write the whole report as one frame: its size in bytes followed by the packed pairs
+    size_t messageSize = misplacedFiles.size() * sizeof(MisplacedFile);
+    if (!writeFull(writePipeFd, &messageSize, sizeof(messageSize)))
     {
-        // Read the process index for the file to determine which client it belongs to
-        int processIdx = this->getDataFileProcessIdx(file);
+        DEBUG_ERROR("Failed to write message size to pipe", debugChFile);
+        exit(158);
+    }
 
-        std::string message2 = "Processing file: " + file + " for client process " + std::to_string(processIdx);
-        DEBUG_FILE(message2, debugChFile);
+    if (!writeFull(writePipeFd, misplacedFiles.data(), messageSize))
+    {
+        DEBUG_ERROR("Failed to write message to pipe", debugChFile);
+        exit(159);
+    }
+
+    DEBUG_FILE("Reported " + std::to_string(misplacedFiles.size()) + " misplaced files", debugChFile);
+}
 
-        // Figure out if the file belongs to the current client.
-        // If so, add it to the list of verified files.
-        if (processIdx == this->clientIdx)
+/**
+ * @brief Partitions the client's subset of data files into its own and misplaced ones.
+ *
+ * This function reads the process index for each file to determine which client
+ * owns its block (see getBlockOwner). Files that can't be read or that name a block
+ * that doesn't exist are skipped. If the file belongs to the current client, it is
+ * added to the list of verified files. If not, the correct client index and the file's
+ * index in the manifest are added to the list of misplaced files that is returned.
+ *
+ * The client's subset of files is the range [filesStartIdx, filesEndIdx) of the
+ * manifest shared by the server.
+ *
+ * @param numClients The number of clients.
+ * @param numBlocks The number of blocks of code, one per process index.
+ * @param manifest The manifest holding the paths of all the data files.
+ * @return The files in the client's subset that belong to other clients.
+ */
+std::vector<Client::MisplacedFile> Client::partitionDataFiles(int numClients, int numBlocks, const Manifest &manifest)
+{
+    PhaseTimer timer("partitionDataFiles");
+
+    std::string debugChFile = "debug_ch_" + std::to_string(this->clientIdx) + ".log";
+    DEBUG_FILE("Verifying data files for client " + std::to_string(this->clientIdx), debugChFile);
+
+    std::vector<MisplacedFile> misplacedFiles;
+
+    // Go through the specified subset of files and add them to the appropriate client's list.
+    // The files are read in batches so their headers can be parsed together.
+    std::vector<std::string> batch;
+    std::vector<FragmentView> fragments;
+    std::vector<bool> parsed;
+    for (int batchStart = this->filesStartIdx; batchStart < this->filesEndIdx; batchStart += FragmentReader::BATCH_SIZE)
+    {
+        int batchEnd = std::min<int>(batchStart + FragmentReader::BATCH_SIZE, this->filesEndIdx);
+        batch.clear();
+        for (int i = batchStart; i < batchEnd; i++)
         {
-            this->addFile(file);
+            batch.emplace_back(manifest.getFile(i));
         }
 
-        // If not, write the correct client index and the file path to the pipe so it can be
-        // sent to the server (who will then send it to the correct client)
-        else
+        // Read the whole line once so the processor doesn't have to open the file again
+        this->reader.readBatch(batch.data(), batch.size(), fragments, parsed);
+
+        for (int i = batchStart; i < batchEnd; i++)
         {
-            // Write the correct client index and the file path to the pipe
-            std::string serverMessage = std::to_string(processIdx) + " " + file;
-            size_t messageSize = serverMessage.size();
+            const std::string &dataFile = batch[i - batchStart];
+            const FragmentView &fragment = fragments[i - batchStart];
+            if (!parsed[i - batchStart])
+            {
+                std::cerr << "Error reading data file: " << dataFile << std::endl;
+                DEBUG_WARNING("Skipping unreadable data file: " + dataFile, debugChFile);
+                continue;
+            }
+
+            // The process index determines which client the file belongs to
+            int processIdx = fragment.processIdx;
 
-            if (write(writePipeFd, &messageSize, sizeof(messageSize)) == -1)
+            std::string message2 = "Processing file: " + dataFile + " for client process " + std::to_string(processIdx);
+            DEBUG_LOG(LogLevel::Debug, message2, debugChFile);
+
+            // A file that names a block that doesn't exist is skipped
+            if (processIdx < 0 || processIdx >= numBlocks)
             {
-                DEBUG_FILE("Failed to write message size to pipe", debugChFile);
-                exit(158);
+                DEBUG_WARNING("Skipping file with invalid process index: " + dataFile, debugChFile);
+                continue;
             }
 
-            if (write(writePipeFd, serverMessage.c_str(), messageSize) == -1)
+            // Figure out if the file belongs to the current client.
+            // If so, add it to the list of verified files.
+            int ownerIdx = Client::getBlockOwner(processIdx, numBlocks, numClients);
+            if (ownerIdx == this->clientIdx)
             {
-                DEBUG_FILE("Failed to write message to pipe", debugChFile);
-                exit(159);
+                this->verifiedFiles.push_back(dataFile);
+                this->verifiedLines.append(fragment.processIdx, fragment.lineNum, fragment.code);
+            }
+
+            // If not, add the correct client index and the file index to the report so it can be
+            // sent to the server (who will then send it to the correct client)
+            else
+            {
+                misplacedFiles.push_back({static_cast<uint32_t>(ownerIdx), static_cast<uint32_t>(i)});
             }
         }
     }
+
+    return misplacedFiles;
+}
+
+/**
+ * @brief Finds the client that owns a block of code.
+ *
+ * The blocks are split into contiguous ranges, one per client, as evenly as possible.
+ * Client i owns blocks [i * numBlocks / numClients, (i + 1) * numBlocks / numClients),
+ * so concatenating the clients' results in order keeps the blocks in order.
+ *
+ * @param processIdx The process index of the block.
+ * @param numBlocks The number of blocks of code.
+ * @param numClients The number of clients.
+ * @return The index of the client that owns the block.
+ */
+int Client::getBlockOwner(int processIdx, int numBlocks, int numClients)
+{
+    // The last client whose range starts at or before the block
+    return static_cast<int>(((static_cast<long long>(processIdx) + 1) * numClients - 1) / numBlocks);
 }
 
 /**
@@ -207,30 +309,51 @@ void Client::verifyDataFilesDistribution(int numClients, const std::vector<std::
  * This function forks a child process and launches the processor program.
  * The arguments passed to the "processor" executable include:
  * - The path to the "processor" executable.
- * - The write end of the pipe to send the results to the distributor process.
+ * - The write end of the pipe to the server.
  * - The client index.
- * - The number of verified files.
- * - The list of verified files.
+ * - The read end of the pipe the parsed lines are sent over.
+ * - The number of parsed lines.
+ * - The read end of the pipe from the server.
+ * - The output file.
+ *
+ * Once the processor is launched, the distributor sends it the lines it already parsed
+ * while verifying the data files, so the processor never opens the data files itself.
  *
  * Invariant: Distributor process has updated the client's list of verified files.
  *
- * @param writePipeFd The file descriptor for the write end of the pipe.
- * @return A string containing the combined results from processing each client's
- * data files.
+ * @param writePipeFd The file descriptor for the write end of the pipe to the server.
+ * @param readPipeFd The file descriptor for the read end of the pipe from the server.
+ * @param outputFd The file descriptor of the output file.
  *
  * @throws std::runtime_error if the fork fails or execvp fails.
  */
-void Client::initializeProcessor(int writePipeFd)
+void Client::initializeProcessor(int writePipeFd, int readPipeFd, int outputFd)
 {
+    PhaseTimer timer("initializeProcessor");
+
+    // Create a pipe to hand the parsed lines down to the processor
+    int pipeLines[2]; // [0] = read, [1] = write
+    if (pipe(pipeLines) == -1)
+    {
+        std::cerr << "Creating processor pipe failed" << std::endl;
+        exit(170);
+    }
+
     pid_t pid = fork();
     if (pid == 0)
     {
         // Child process
-        this->runProcessorChildProcess(writePipeFd);
+        close(pipeLines[1]); // Close write end of the lines pipe
+        this->runProcessorChildProcess(writePipeFd, pipeLines[0], readPipeFd, outputFd);
         exit(0); // Exit child process
     }
     else if (pid > 0)
     {
+        // Send the parsed lines to the processor, closing the pipe to signal the end
+        close(pipeLines[0]); // Close read end of the lines pipe
+        this->sendLinesToProcessor(pipeLines[1]);
+        close(pipeLines[1]);
+
         // Parent process should wait for the child process to finish
         int status;
         wait(&status);
@@ -251,40 +374,35 @@ void Client::initializeProcessor(int writePipeFd)
  * This function is called by the child process to run the processor program.
  * The processor is sent the files belonging to the current client that were distributed
  * via the distributor parent process and process them by sorting the lines based on their
- * line numbers, and combines them into a single block of code. The results are written via
- * a pipe to be read by the distributor (parent) process and eventually processed by the server.
+ * line numbers, and combines them into a single block of code. The block is written
+ * straight into the output file at the offset the server gives it.
  *
- * @param writePipeFd The file descriptor for the write end of the pipe.
+ * @param writePipeFd The file descriptor for the write end of the pipe to the server.
+ * @param readLinesFd The file descriptor for the read end of the pipe the parsed
+ * lines are sent over.
+ * @param readPipeFd The file descriptor for the read end of the pipe from the server.
+ * @param outputFd The file descriptor of the output file.
  */
-void Client::runProcessorChildProcess(int writePipeFd)
+void Client::runProcessorChildProcess(int writePipeFd, int readLinesFd, int readPipeFd, int outputFd)
 {
     // Child (Grandchild) process
-    size_t numFiles = this->verifiedFiles.size();
-
-    // Precompute the total number of arguments
-    unsigned int baseArgs = 4;
-    size_t totalArgs = baseArgs + numFiles + 1;
-
-    // Create a vector of strings to store the arguments
-    std::vector<std::string> args(totalArgs);
-    args[0] = std::string(EXECUTABLES_PATH + "processor");
-    args[1] = std::to_string(writePipeFd);
-    args[2] = std::to_string(this->clientIdx);
-    args[3] = std::to_string(numFiles);
-
-    // Add the subset of files for the current client to the argument list
-    for (size_t j = 0; j < numFiles; j++)
-    {
-        args[j + baseArgs] = this->verifiedFiles[j];
-    }
+    // The lines themselves are sent over the pipe, so only their count is passed along
+    std::vector<std::string> args = {
+        std::string(EXECUTABLES_PATH + "processor"),
+        std::to_string(writePipeFd),
+        std::to_string(this->clientIdx),
+        std::to_string(readLinesFd),
+        std::to_string(this->verifiedLines.size()),
+        std::to_string(readPipeFd),
+        std::to_string(outputFd)};
 
     // Convert the vector of strings to a vector of char* for execvp
-    std::vector<char *> c_args(totalArgs);
-    for (size_t i = 0; i < totalArgs; i++)
+    std::vector<char *> c_args(args.size() + 1);
+    for (size_t i = 0; i < args.size(); i++)
     {
         c_args[i] = const_cast<char *>(args[i].c_str());
     }
-    c_args[totalArgs - 1] = nullptr; // Null-terminate the argument list
+    c_args[args.size()] = nullptr; // Null-terminate the argument list
 
     DEBUG_FILE("Launching processor for client " + std::to_string(this->clientIdx), "debug.log");
 
@@ -297,151 +415,306 @@ void Client::runProcessorChildProcess(int writePipeFd)
 }
 
 /**
- * @brief Processes data files associated with the client and writes the results to a
- * pipe to be read by the parent distributor process.
+ * @brief Sends the cached parsed lines to the processor process.
  *
- * This function iterates over the list of files associated with the client, reads
- * their contents, and stores them in a vector. Each file's contents are represented
- * as a LineData object, which includes the line number and the code.
- * The lines are then sorted based on their line numbers to ensure the correct order.
- * Finally, the sorted lines are written in order to a pipe to be read by the distributor
- * process.
+ * Serializes every verified line into a single buffer and writes it to the pipe
+ * so that the processor can rebuild the lines without reading the data files.
  *
- * Invariant: The input data files properly have the lines associated with the client
- * that puts them in the correct order.
+ * @param writeLinesFd The file descriptor for the write end of the pipe.
+ */
+void Client::sendLinesToProcessor(int writeLinesFd)
+{
+    PhaseTimer timer("sendLinesToProcessor");
+
+    // Each record is the process index, the line number, the code size, then the code
+    const std::vector<int> &processIdx = this->verifiedLines.getProcessIdx();
+    const std::vector<int> &lineNums = this->verifiedLines.getLineNums();
+
+    std::string buffer;
+    buffer.reserve(this->verifiedLines.size() * (2 * sizeof(int) + sizeof(size_t)) + this->verifiedLines.textSize());
+    for (size_t row = 0; row < this->verifiedLines.size(); row++)
+    {
+        std::string_view code = this->verifiedLines.getCode(row);
+        size_t codeSize = code.size();
+        buffer.append(reinterpret_cast<const char *>(&processIdx[row]), sizeof(int));
+        buffer.append(reinterpret_cast<const char *>(&lineNums[row]), sizeof(int));
+        buffer.append(reinterpret_cast<const char *>(&codeSize), sizeof(codeSize));
+        buffer.append(code);
+    }
+
+    // The processor is reading concurrently, so keep writing until the whole buffer is through
+    if (!writeFull(writeLinesFd, buffer.data(), buffer.size()))
+    {
+        DEBUG_ERROR("Failed to send parsed lines to processor for client " + std::to_string(this->clientIdx), "debug.log");
+        exit(174);
+    }
+}
+
+/**
+ * @brief Receives the parsed lines sent by the distributor process.
  *
- * @param writePipeFd The file descriptor for the write end of the pipe.
- * @return A string containing the concatenated contents of all the data files,
- * ordered by line number.
+ * Reads the records written by sendLinesToProcessor until the pipe is closed. Each
+ * record is the process index, the line number, the size of the code, and the code
+ * itself. The buffer the records were received into becomes the text blob of the
+ * client's FragmentTable, so receiving the lines doesn't allocate a string per line.
+ *
+ * @param readPipeFd The file descriptor for the read end of the pipe.
+ * @param numLines The number of lines the distributor is sending.
  */
-void Client::processDataFiles(int writePipeFd)
+void Client::receiveLines(int readPipeFd, size_t numLines)
 {
+    PhaseTimer timer("receiveLines");
+
     std::string debugChFile = "debug_sch_" + std::to_string(this->clientIdx) + ".log";
 
-    // Create a vector to store all the lines
-    std::vector<LineData> lines = std::vector<LineData>(this->verifiedFiles.size());
+    // Drain the whole pipe first, then parse the records out of the buffer
+    std::string buffer;
+    char chunk[4096];
+    ssize_t bytesRead;
+    while ((bytesRead = read(readPipeFd, chunk, sizeof(chunk))) > 0)
+    {
+        buffer.append(chunk, bytesRead);
+    }
 
-    for (size_t i = 0; i < this->verifiedFiles.size(); i++)
+    if (bytesRead == -1)
     {
-        std::string file = this->verifiedFiles[i];
+        DEBUG_ERROR("Failed to read parsed lines from distributor", debugChFile);
+        exit(175);
+    }
+
+    // The buffer becomes the table's text blob. Each record's code is moved down over
+    // the headers in front of it, so the code ends up back to back at the start of the
+    // buffer and the rows only keep an offset and a length into it.
+    this->verifiedLines.clear();
+    this->verifiedLines.reserve(numLines, 0);
 
-        std::string message = "Processing data file " + file + " for client " + std::to_string(this->clientIdx);
-        DEBUG_FILE(message, debugChFile);
+    size_t pos = 0;
+    size_t textSize = 0;
+    const size_t headerSize = 2 * sizeof(int) + sizeof(size_t);
+    while (pos + headerSize <= buffer.size())
+    {
+        int processIdx;
+        int lineNum;
+        size_t codeSize;
+        std::memcpy(&processIdx, buffer.data() + pos, sizeof(processIdx));
+        std::memcpy(&lineNum, buffer.data() + pos + sizeof(int), sizeof(lineNum));
+        std::memcpy(&codeSize, buffer.data() + pos + 2 * sizeof(int), sizeof(codeSize));
+        pos += headerSize;
+
+        if (pos + codeSize > buffer.size())
+        {
+            DEBUG_ERROR("Truncated line record received from distributor", debugChFile);
+            exit(176);
+        }
 
-        // Get the line data and put them in order based on the line number
-        LineData lineData = this->getDataFileContents(file);
-        lines[i] = lineData;
+        std::memmove(buffer.data() + textSize, buffer.data() + pos, codeSize);
+        this->verifiedLines.appendSpan(processIdx, lineNum, textSize, codeSize);
+        textSize += codeSize;
+        pos += codeSize;
     }
 
-    // Sort the lines based on the line number
-    std::sort(lines.begin(), lines.end(), [](const LineData &a, const LineData &b)
-              { return a.lineNum < b.lineNum; });
+    buffer.resize(textSize);
+    this->verifiedLines.adoptText(std::move(buffer));
 
-    // Write the sorted lines to the pipe, moving back up the communication chain
-    // so the distributor can receive the sorted lines and combine them into a single block of code.
-    std::string message;
-    for (const auto &line : lines)
+    if (this->verifiedLines.size() != numLines)
     {
-        message += line.code + "\n";
+        DEBUG_ERROR("Expected " + std::to_string(numLines) + " lines but received " + std::to_string(this->verifiedLines.size()), debugChFile);
+        exit(177);
     }
-    size_t messageSize = message.size();
+}
 
-    // Check if adding this message would exceed the 4KB limit
-    if (messageSize > PIPE_CAPACITY)
+/**
+ * @brief Processes data files associated with the client and writes the block of code
+ * straight into the output file.
+ *
+ * This function combines the lines already parsed from the data files associated
+ * with the client into a block of code with combineLines. Only the size of the block is
+ * sent to the server, which replies with the offset of the block in the output file once
+ * it knows the size of every block. The block is then written at that offset, so the
+ * server never has to handle the code itself. An empty frame tells the server the block
+ * has been written.
+ *
+ * Invariant: The input data files properly have the lines associated with the client
+ * that puts them in the correct order.
+ *
+ * @param writePipeFd The file descriptor for the write end of the pipe to the server.
+ * @param readPipeFd The file descriptor for the read end of the pipe from the server.
+ * @param outputFd The file descriptor of the output file shared by every processor.
+ */
+void Client::processDataFiles(int writePipeFd, int readPipeFd, int outputFd)
+{
+    PhaseTimer timer("processDataFiles");
+
+    std::string debugChFile = "debug_sch_" + std::to_string(this->clientIdx) + ".log";
+
+    std::string block = this->combineLines();
+
+    // Report the size of the block as a frame holding a single size_t
+    size_t frame[2] = {sizeof(size_t), block.size()};
+    if (!writeFull(writePipeFd, frame, sizeof(frame)))
     {
-        DEBUG_FILE("Combined message size exceeds 4KB limit", debugChFile);
-        exit(200);
+        DEBUG_ERROR("Failed to write block size to pipe", debugChFile);
+        exit(172);
     }
 
-    if (write(writePipeFd, &messageSize, sizeof(messageSize)) == -1)
+    // Wait for the server to place the block in the output file
     {
-        DEBUG_FILE("Failed to write message size to pipe", debugChFile);
-        exit(172);
+        PhaseTimer awaitTimer("awaitBlockOffset");
+        if (readFull(readPipeFd, frame, sizeof(frame)) != sizeof(frame) || frame[0] != sizeof(size_t))
+        {
+            DEBUG_ERROR("Failed to read block offset from pipe", debugChFile);
+            exit(178);
+        }
     }
 
-    if (write(writePipeFd, message.c_str(), messageSize) == -1)
+    size_t offset = frame[1];
     {
-        DEBUG_FILE("Failed to write message to pipe", debugChFile);
+        PhaseTimer writeTimer("writeBlock");
+        if (!pwriteFull(outputFd, block.data(), block.size(), offset))
+        {
+            DEBUG_ERROR("Failed to write block to the output file", debugChFile);
+            exit(179);
+        }
+    }
+
+    DEBUG_LOG(LogLevel::Debug, "Wrote " + std::to_string(block.size()) + " bytes at offset " + std::to_string(offset), debugChFile);
+
+    // Tell the server the block is in place
+    size_t doneSignal = 0;
+    if (!writeFull(writePipeFd, &doneSignal, sizeof(doneSignal)))
+    {
+        DEBUG_ERROR("Failed to write done signal to pipe", debugChFile);
         exit(173);
     }
 }
 
 /**
- * @brief Retrieves the process index from the first line of a given file.
+ * @brief Orders the client's lines and combines them into a single block of code.
  *
- * Opens the specified file and reads the first line to extract
- * an integer value representing the process index. If the file cannot be opened
- * or the first line does not contain a valid integer, the function returns -1.
+ * The lines are kept in a FragmentTable, so they are ordered by their process index and
+ * then their line number using only the two integer columns. The code is then copied
+ * once, straight out of the table's text blob into the block, with a newline after
+ * each line.
  *
- * @param filename The path to the file containing the process index.
- * @return The process index read from the file, or -1 if an error occurs.
+ * @return A string containing the concatenated contents of all the data files,
+ * ordered by line number.
  */
-int Client::getDataFileProcessIdx(const std::string &filename)
+std::string Client::combineLines()
 {
-    std::ifstream file(filename);
-    int processIdx = -1;
+    PhaseTimer timer("combineLines");
 
-    if (!file.is_open())
+    std::string debugChFile = "debug_sch_" + std::to_string(this->clientIdx) + ".log";
+    DEBUG_FILE("Processing " + std::to_string(this->verifiedLines.size()) + " lines for client " + std::to_string(this->clientIdx), debugChFile);
+
+    // Order the lines based on the block they belong to, then the line number
+    std::vector<uint32_t> rows;
+    OrderReport report = this->verifiedLines.order(rows);
+    if (report.duplicateLines > 0 || report.missingLines > 0)
+    {
+        std::cerr << "Client " << this->clientIdx << " found " << report.duplicateLines << " duplicate and "
+                  << report.missingLines << " missing line numbers" << std::endl;
+    }
+
+    return this->verifiedLines.join(rows);
+}
+
+/**
+ * @brief Joins lines that are already in order into a block of code.
+ *
+ * The size of the block is added up first so the block is allocated once, then each
+ * line and its newline are appended without building a temporary string per line.
+ *
+ * @param lines The lines to join, in order.
+ * @return The code of every line, each followed by a newline.
+ */
+std::string Client::joinLines(const std::vector<LineData> &lines)
+{
+    size_t blockSize = 0;
+    for (const auto &line : lines)
     {
-        std::cerr << "Error opening data file: " << filename << std::endl;
-        return processIdx;
+        blockSize += line.code.size() + 1;
     }
 
-    std::string line;
-    if (std::getline(file, line))
+    std::string block;
+    block.reserve(blockSize);
+    for (const auto &line : lines)
     {
-        std::istringstream iss(line);
-        iss >> processIdx;
+        block.append(line.code);
+        block.push_back('\n');
     }
 
-    return processIdx;
+    return block;
 }
 
 /**
- * @brief Reads the contents of a file and extracts specific data.
+ * @brief Adds a batch of lines to the client's lines.
  *
- * This function opens a file specified by the given filename, reads the first line,
- * and extracts the process index, line number, and code from the line. The extracted
- * values are stored in a LineData structure and returned.
+ * The batch's columns are appended to the client's table as they arrive, and the
+ * lines are ordered once by combineLines, which takes linear time when the line
+ * numbers are dense. The batch is left empty.
  *
- * @param filename The name of the file to read.
- * @return A LineData structure containing the extracted values. If the file cannot be
- *         opened, an empty LineData structure is returned.
+ * @param batch The lines to add to the client.
  */
-Client::LineData Client::getDataFileContents(const std::string &filename)
+void Client::mergeLines(FragmentTable &batch)
 {
-    std::ifstream file(filename);
-    LineData allValues;
+    this->verifiedLines.append(batch);
+}
 
-    if (!file.is_open())
+/**
+ * @brief Puts lines in (processIdx, lineNum) order without comparing the lines.
+ *
+ * The process index and line number of every line are copied into two columns and
+ * ordered with FragmentTable::orderRows, then each line is moved once into its place.
+ * The code strings are never swapped around by a sort.
+ *
+ * @param lines The lines to order.
+ * @return The number of duplicate and missing line numbers that were found.
+ */
+OrderReport Client::orderLines(std::vector<LineData> &lines)
+{
+    std::vector<int> processIdx(lines.size());
+    std::vector<int> lineNums(lines.size());
+    for (size_t i = 0; i < lines.size(); i++)
     {
-        std::cerr << "Error opening data file: " << filename << std::endl;
-        return allValues;
+        processIdx[i] = lines[i].processIdx;
+        lineNums[i] = lines[i].lineNum;
     }
 
-    std::string line;
-    if (std::getline(file, line))
+    std::vector<uint32_t> rows;
+    OrderReport report = FragmentTable::orderRows(processIdx, lineNums, rows);
+
+    std::vector<LineData> ordered;
+    ordered.reserve(lines.size());
+    for (uint32_t row : rows)
     {
-        // Extract process index, line number, and code from the line
-        std::istringstream iss(line);
-        int processIdx, lineNum;
-        std::string code;
+        ordered.push_back(std::move(lines[row]));
+    }
 
-        if (iss >> processIdx >> lineNum)
-        {
-            // Skip the first space after lineNum
-            if (iss.peek() == ' ')
-            {
-                iss.get();
-            }
-            // Get the rest of the line as the code, including leading whitespace
-            std::getline(iss, code);
+    lines.swap(ordered);
+    return report;
+}
 
-            allValues.processIdx = processIdx;
-            allValues.lineNum = lineNum;
-            allValues.code = code;
-        }
+/**
+ * @brief Reads the contents of a file and extracts specific data.
+ *
+ * This function reads the first line of the file specified by the given filename
+ * through the client's FragmentReader, and extracts the process index, line number,
+ * and code from the line. The code is a view into the reader's buffer, so it has to be
+ * copied out (e.g. into the client's FragmentTable) before the next file is read.
+ *
+ * @param filename The name of the file to read.
+ * @param fragment Filled with the extracted values. If the file cannot be opened, the
+ *        process index and line number are -1 and the code is empty.
+ * @return True if the file was read and parsed, false otherwise.
+ */
+bool Client::getDataFileContents(const std::string &filename, FragmentView &fragment)
+{
+    if (!this->reader.read(filename, fragment))
+    {
+        std::cerr << "Error reading data file: " << filename << std::endl;
+        fragment = {-1, -1, std::string_view()};
+        return false;
     }
 
-    return allValues;
+    return true;
 }
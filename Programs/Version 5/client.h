@@ -6,16 +6,52 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
 #include <numeric>
 #include <algorithm>
 #include <unistd.h>
 #include <sys/wait.h>
 
+#include "fragmentReader.h"
+#include "fragmentTable.h"
+#include "phaseTimer.h"
+#include "manifest.h"
+
 extern std::string EXECUTABLES_PATH;
 
 class Client
 {
 public:
+    /**
+     * @struct MisplacedFile
+     * @brief An entry in the report a distributor sends the server after verification.
+     *
+     * Refers to a data file by its index in the server's list of files, along with the
+     * index of the client the file actually belongs to.
+     */
+    struct MisplacedFile
+    {
+        uint32_t targetIdx;
+        uint32_t fileIdx;
+    };
+
+    /**
+     * @struct LineData
+     * @brief Represents a line of code with associated metadata.
+     *
+     * Holds information about a specific line of code from a data file,
+     * including the index of the process, the line number, and the actual
+     * code content.
+     */
+    struct LineData
+    {
+        int processIdx;
+        int lineNum;
+        std::string code;
+    };
+
     /**
      * Constructs a client that represents a "distributor" process, whose job is to
      * process a subset of the data files associated with the distributor process.
@@ -79,6 +115,10 @@ public:
     /**
      * Adds a file to the list of files.
      *
+     * The file is read once here and its parsed line is cached alongside the path so the
+     * processor never has to open the file again. A file that can no longer be read, or that
+     * has a negative process index, is skipped.
+     *
      * @param file The file to add to the list.
      */
     void addFile(const std::string &file);
@@ -111,17 +151,50 @@ public:
      * @brief Verifies the distribution of data files among clients and sneds the
      * incorrectly distributed files to the server for redistribution.
      *
-     * This function reads the process index for each file to determine which client
-     * it belongs to. If the file belongs to the current client, it is added to the
-     * list of verified files. If not, the correct client index and file path are
-     * written to the pipe so the server can send the file to the correct client.
+     * This function splits the client's subset of files with partitionDataFiles. Once every file
+     * has been checked, the whole report of incorrectly distributed files is written to the
+     * pipe as a single frame so the server can send the files to the correct clients. The
+     * frame also tells the server this client is done verifying.
      *
      * @param numClients The number of clients.
-     * @param files A vector of strings containing the subset of files to be verified
-     * and distributed by the current client.
+     * @param numBlocks The number of blocks of code, one per process index.
+     * @param manifest The manifest holding the paths of all the data files.
      * @param writePipeFd The file descriptor for the write end of the pipe.
      */
-    void verifyDataFilesDistribution(int numClients, const std::vector<std::string> &files, int writePipeFd);
+    void verifyDataFilesDistribution(int numClients, int numBlocks, const Manifest &manifest, int writePipeFd);
+
+    /**
+     * @brief Partitions the client's subset of data files into its own and misplaced ones.
+     *
+     * This function reads the process index for each file to determine which client
+     * owns its block (see getBlockOwner). Files that can't be read or that name a block
+     * that doesn't exist are skipped. If the file belongs to the current client, it is
+     * added to the list of verified files. If not, the correct client index and the file's
+     * index in the manifest are added to the list of misplaced files that is returned.
+     *
+     * The client's subset of files is the range [filesStartIdx, filesEndIdx) of the
+     * manifest shared by the server.
+     *
+     * @param numClients The number of clients.
+     * @param numBlocks The number of blocks of code, one per process index.
+     * @param manifest The manifest holding the paths of all the data files.
+     * @return The files in the client's subset that belong to other clients.
+     */
+    std::vector<MisplacedFile> partitionDataFiles(int numClients, int numBlocks, const Manifest &manifest);
+
+    /**
+     * @brief Finds the client that owns a block of code.
+     *
+     * The blocks are split into contiguous ranges, one per client, as evenly as possible.
+     * Client i owns blocks [i * numBlocks / numClients, (i + 1) * numBlocks / numClients),
+     * so concatenating the clients' results in order keeps the blocks in order.
+     *
+     * @param processIdx The process index of the block.
+     * @param numBlocks The number of blocks of code.
+     * @param numClients The number of clients.
+     * @return The index of the client that owns the block.
+     */
+    static int getBlockOwner(int processIdx, int numBlocks, int numClients);
 
     /**
      * @brief Initializes the processor process to sort and combine the data files
@@ -130,40 +203,105 @@ public:
      * This function forks a child process and launches the processor program.
      * The arguments passed to the "processor" executable include:
      * - The path to the "processor" executable.
-     * - The write end of the pipe to send the results to the distributor process.
+     * - The write end of the pipe to the server.
      * - The client index.
-     * - The number of verified files.
-     * - The list of verified files.
+     * - The read end of the pipe the parsed lines are sent over.
+     * - The number of parsed lines.
+     * - The read end of the pipe from the server.
+     * - The output file.
+     *
+     * Once the processor is launched, the distributor sends it the lines it already parsed
+     * while verifying the data files, so the processor never opens the data files itself.
      *
      * Invariant: Distributor process has updated the client's list of verified files.
      *
-     * @param writePipeFd The file descriptor for the write end of the pipe.
-     * @return A string containing the combined results from processing each client's
-     * data files.
+     * @param writePipeFd The file descriptor for the write end of the pipe to the server.
+     * @param readPipeFd The file descriptor for the read end of the pipe from the server.
+     * @param outputFd The file descriptor of the output file.
      *
      * @throws std::runtime_error if the fork fails or execvp fails.
      */
-    void initializeProcessor(int writePipeFd);
+    void initializeProcessor(int writePipeFd, int readPipeFd, int outputFd);
+
+    /**
+     * @brief Receives the parsed lines sent by the distributor process.
+     *
+     * Reads the records written by sendLinesToProcessor until the pipe is closed. Each
+     * record is the process index, the line number, the size of the code, and the code
+     * itself. The buffer the records were received into becomes the text blob of the
+     * client's FragmentTable, so receiving the lines doesn't allocate a string per line.
+     *
+     * @param readPipeFd The file descriptor for the read end of the pipe.
+     * @param numLines The number of lines the distributor is sending.
+     */
+    void receiveLines(int readPipeFd, size_t numLines);
 
     /**
-     * @brief Processes data files associated with the client and writes the results to a
-     * pipe to be read by the parent distributor process.
+     * @brief Processes data files associated with the client and writes the block of code
+     * straight into the output file.
      *
-     * This function iterates over the list of files associated with the client, reads
-     * their contents, and stores them in a vector. Each file's contents are represented
-     * as a LineData object, which includes the line number and the code.
-     * The lines are then sorted based on their line numbers to ensure the correct order.
-     * Finally, the sorted lines are written in order to a pipe to be read by the distributor
-     * process.
+     * This function combines the lines already parsed from the data files associated
+     * with the client into a block of code with combineLines. Only the size of the block is
+     * sent to the server, which replies with the offset of the block in the output file once
+     * it knows the size of every block. The block is then written at that offset, so the
+     * server never has to handle the code itself. An empty frame tells the server the block
+     * has been written.
      *
      * Invariant: The input data files properly have the lines associated with the client
      * that puts them in the correct order.
      *
-     * @param writePipeFd The file descriptor for the write end of the pipe.
+     * @param writePipeFd The file descriptor for the write end of the pipe to the server.
+     * @param readPipeFd The file descriptor for the read end of the pipe from the server.
+     * @param outputFd The file descriptor of the output file shared by every processor.
+     */
+    void processDataFiles(int writePipeFd, int readPipeFd, int outputFd);
+
+    /**
+     * @brief Orders the client's lines and combines them into a single block of code.
+     *
+     * The lines are kept in a FragmentTable, so they are ordered by their process index and
+     * then their line number using only the two integer columns. The code is then copied
+     * once, straight out of the table's text blob into the block, with a newline after
+     * each line.
+     *
      * @return A string containing the concatenated contents of all the data files,
      * ordered by line number.
      */
-    void processDataFiles(int writePipeFd);
+    std::string combineLines();
+
+    /**
+     * @brief Adds a batch of lines to the client's lines.
+     *
+     * The batch's columns are appended to the client's table as they arrive, and the
+     * lines are ordered once by combineLines, which takes linear time when the line
+     * numbers are dense. The batch is left empty.
+     *
+     * @param batch The lines to add to the client.
+     */
+    void mergeLines(FragmentTable &batch);
+
+    /**
+     * @brief Puts lines in (processIdx, lineNum) order without comparing the lines.
+     *
+     * The process index and line number of every line are copied into two columns and
+     * ordered with FragmentTable::orderRows, then each line is moved once into its place.
+     * The code strings are never swapped around by a sort.
+     *
+     * @param lines The lines to order.
+     * @return The number of duplicate and missing line numbers that were found.
+     */
+    static OrderReport orderLines(std::vector<LineData> &lines);
+
+    /**
+     * @brief Joins lines that are already in order into a block of code.
+     *
+     * The size of the block is added up first so the block is allocated once, then each
+     * line and its newline are appended without building a temporary string per line.
+     *
+     * @param lines The lines to join, in order.
+     * @return The code of every line, each followed by a newline.
+     */
+    static std::string joinLines(const std::vector<LineData> &lines);
 
 private:
     /**
@@ -186,58 +324,59 @@ private:
      */
     std::vector<std::string> verifiedFiles;
 
+    /**
+     * The parsed contents of the verified files, cached so that each data file is only
+     * read once across the distributor and processor stages. The processor's table is
+     * built around the buffer the lines were received into.
+     */
+    FragmentTable verifiedLines;
+
+    /**
+     * Reads the data files into a buffer that is reused across every file the client reads.
+     */
+    FragmentReader reader;
+
     /**
      * @brief Runs the processor child process to sort and combine the data files.
      *
      * This function is called by the child process to run the processor program.
      * The processor is sent the files belonging to the current client that were distributed
      * via the distributor parent process and process them by sorting the lines based on their
-     * line numbers, and combines them into a single block of code. The results are written via
-     * a pipe to be read by the distributor (parent) process and eventually processed by the server.
+     * line numbers, and combines them into a single block of code. The block is written
+     * straight into the output file at the offset the server gives it.
      *
-     * @param writePipeFd The file descriptor for the write end of the pipe.
+     * @param writePipeFd The file descriptor for the write end of the pipe to the server.
+     * @param readLinesFd The file descriptor for the read end of the pipe the parsed
+     * lines are sent over.
+     * @param readPipeFd The file descriptor for the read end of the pipe from the server.
+     * @param outputFd The file descriptor of the output file.
      */
-    void runProcessorChildProcess(int writePipeFd);
+    void runProcessorChildProcess(int writePipeFd, int readLinesFd, int readPipeFd, int outputFd);
 
     /**
-     * @brief Retrieves the process index from the first line of a given file.
-     *
-     * Opens the specified file and reads the first line to extract
-     * an integer value representing the process index. If the file cannot be opened
-     * or the first line does not contain a valid integer, the function returns -1.
+     * @brief Sends the cached parsed lines to the processor process.
      *
-     * @param filename The path to the file containing the process index.
-     * @return The process index read from the file, or -1 if an error occurs.
-     */
-    int getDataFileProcessIdx(const std::string &filename);
-
-    /**
-     * @struct LineData
-     * @brief Represents a line of code with associated metadata.
+     * Serializes every verified line into a single buffer and writes it to the pipe
+     * so that the processor can rebuild the lines without reading the data files.
      *
-     * Holds information about a specific line of code from a data file,
-     * including the index of the process, the line number, and the actual
-     * code content.
+     * @param writeLinesFd The file descriptor for the write end of the pipe.
      */
-    struct LineData
-    {
-        int processIdx;
-        int lineNum;
-        std::string code;
-    };
+    void sendLinesToProcessor(int writeLinesFd);
 
     /**
      * @brief Reads the contents of a file and extracts specific data.
      *
-     * This function opens a file specified by the given filename, reads the first line,
-     * and extracts the process index, line number, and code from the line. The extracted
-     * values are stored in a LineData structure and returned.
+     * This function reads the first line of the file specified by the given filename
+     * through the client's FragmentReader, and extracts the process index, line number,
+     * and code from the line. The code is a view into the reader's buffer, so it has to be
+     * copied out (e.g. into the client's FragmentTable) before the next file is read.
      *
      * @param filename The name of the file to read.
-     * @return A LineData structure containing the extracted values. If the file cannot be
-     *         opened, an empty LineData structure is returned.
+     * @param fragment Filled with the extracted values. If the file cannot be opened, the
+     *        process index and line number are -1 and the code is empty.
+     * @return True if the file was read and parsed, false otherwise.
      */
-    LineData getDataFileContents(const std::string &filename);
+    bool getDataFileContents(const std::string &filename, FragmentView &fragment);
 };
 
 #endif // CLIENT_H
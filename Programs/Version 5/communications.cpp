@@ -0,0 +1,151 @@
+#include "communications.h"
+
+/**
+ * @brief Reads exactly the requested number of bytes from a file descriptor.
+ *
+ * A single read on a pipe may return fewer bytes than requested, either because the
+ * writer hasn't sent the rest yet or because the call was interrupted. This function
+ * keeps reading until the buffer is full or the pipe is closed.
+ *
+ * @param fd The file descriptor to read from.
+ * @param buffer Where to store the bytes.
+ * @param size The number of bytes to read.
+ * @return The number of bytes read, which is less than size only if the pipe was closed,
+ * or -1 on error.
+ */
+ssize_t readFull(int fd, void *buffer, size_t size)
+{
+    char *bytes = static_cast<char *>(buffer);
+    size_t total = 0;
+
+    while (total < size)
+    {
+        ssize_t bytesRead = read(fd, bytes + total, size - total);
+        if (bytesRead == 0)
+        {
+            break; // End of the pipe
+        }
+        else if (bytesRead == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        total += bytesRead;
+    }
+
+    return total;
+}
+
+/**
+ * @brief Writes the whole buffer to a file descriptor, retrying after partial writes.
+ *
+ * Writes larger than the pipe buffer block until the reader drains the pipe, and
+ * may return early if interrupted, so keep writing until everything is through.
+ *
+ * @param fd The file descriptor to write to.
+ * @param data The bytes to write.
+ * @param size The number of bytes to write.
+ * @return True if all the bytes were written, false on error.
+ */
+bool writeFull(int fd, const void *data, size_t size)
+{
+    const char *bytes = static_cast<const char *>(data);
+    size_t written = 0;
+
+    while (written < size)
+    {
+        ssize_t bytesWritten = write(fd, bytes + written, size - written);
+        if (bytesWritten == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        written += bytesWritten;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Writes every byte of the given buffers to a file descriptor.
+ *
+ * The buffers are written together with writev, and the call is repeated from wherever
+ * the previous one stopped until everything has been written.
+ *
+ * @param fd The file descriptor to write to.
+ * @param iov The buffers to write, in order. The array is modified as bytes are written.
+ * @param iovcnt The number of buffers.
+ * @return True if every byte was written, false on error.
+ */
+bool writeFull(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0)
+    {
+        ssize_t bytesWritten = writev(fd, iov, iovcnt);
+        if (bytesWritten == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+
+        // Skip past the buffers that were written completely, then move the start of
+        // the partially written one forward
+        while (iovcnt > 0 && static_cast<size_t>(bytesWritten) >= iov->iov_len)
+        {
+            bytesWritten -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+
+        if (iovcnt > 0)
+        {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + bytesWritten;
+            iov->iov_len -= bytesWritten;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Writes the whole buffer to a file at the given offset, retrying after partial writes.
+ *
+ * Several processes write their own regions of the same file at once, so the file's
+ * position is never used.
+ *
+ * @param fd The file descriptor to write to.
+ * @param data The bytes to write.
+ * @param size The number of bytes to write.
+ * @param offset The position in the file to write the first byte at.
+ * @return True if all the bytes were written, false on error.
+ */
+bool pwriteFull(int fd, const void *data, size_t size, off_t offset)
+{
+    const char *bytes = static_cast<const char *>(data);
+    size_t written = 0;
+
+    while (written < size)
+    {
+        ssize_t bytesWritten = pwrite(fd, bytes + written, size - written, offset + written);
+        if (bytesWritten == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        written += bytesWritten;
+    }
+
+    return true;
+}
@@ -0,0 +1,339 @@
+#include "fragmentPack.h"
+#include "fragmentReader.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Writes the fragments of a data folder into a pack file.
+ *
+ * The first line of every file is parsed, and files that can't be read or parsed, or
+ * that have a negative process index, are skipped. The fragments are ordered by
+ * (processIdx, lineNum) like the clients order them, so duplicate line numbers are
+ * kept in the order the files were listed.
+ *
+ * @param files The paths to the data files.
+ * @param packFile The path to the pack file to write.
+ * @param report Set to the number of duplicate and missing line numbers found.
+ * @return The number of fragments written, or -1 if the pack couldn't be written.
+ */
+long long FragmentPack::write(const std::vector<std::string> &files, const std::string &packFile, OrderReport &report)
+{
+    // Parse every file into one table, the same way the engines do
+    FragmentTable table;
+    FragmentReader reader;
+    std::vector<FragmentView> fragments;
+    std::vector<bool> parsed;
+    int highestProcessIdx = -1;
+
+    for (size_t batchStart = 0; batchStart < files.size(); batchStart += FragmentReader::BATCH_SIZE)
+    {
+        size_t batchSize = std::min(FragmentReader::BATCH_SIZE, files.size() - batchStart);
+        reader.readBatch(&files[batchStart], batchSize, fragments, parsed);
+
+        for (size_t i = 0; i < batchSize; i++)
+        {
+            if (!parsed[i] || fragments[i].processIdx < 0)
+            {
+                std::cerr << "Skipping unreadable or invalid data file: " << files[batchStart + i] << std::endl;
+                continue;
+            }
+
+            table.append(fragments[i].processIdx, fragments[i].lineNum, fragments[i].code);
+            highestProcessIdx = std::max(highestProcessIdx, fragments[i].processIdx);
+        }
+    }
+
+    std::vector<uint32_t> rows;
+    report = table.order(rows);
+
+    PackHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.numBlocks = highestProcessIdx + 1;
+    header.numRecords = rows.size();
+    header.textSize = table.textSize() + rows.size();
+
+    // The rows are in order, so each block starts where the process index changes
+    const std::vector<int> &processIdx = table.getProcessIdx();
+    const std::vector<int> &lineNums = table.getLineNums();
+    std::vector<uint64_t> blockStarts(header.numBlocks + 1);
+    std::vector<PackRecord> records(rows.size());
+    uint64_t textOffset = 0;
+    size_t recordIdx = 0;
+
+    for (uint32_t block = 0; block <= header.numBlocks; block++)
+    {
+        blockStarts[block] = recordIdx;
+        while (recordIdx < rows.size() && static_cast<uint32_t>(processIdx[rows[recordIdx]]) == block)
+        {
+            uint32_t row = rows[recordIdx];
+            uint32_t textLength = table.getCode(row).size();
+            records[recordIdx] = {processIdx[row], lineNums[row], textLength, 0, textOffset};
+            textOffset += textLength + 1;
+            recordIdx++;
+        }
+    }
+
+    std::ofstream pack(packFile, std::ios::binary | std::ios::trunc);
+    if (!pack)
+    {
+        std::cerr << "Error opening pack file: " << packFile << std::endl;
+        return -1;
+    }
+
+    pack.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    pack.write(reinterpret_cast<const char *>(blockStarts.data()), blockStarts.size() * sizeof(uint64_t));
+    pack.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(PackRecord));
+    for (uint32_t row : rows)
+    {
+        std::string_view code = table.getCode(row);
+        pack.write(code.data(), code.size());
+        pack.put('\n');
+    }
+
+    if (!pack)
+    {
+        std::cerr << "Error writing pack file: " << packFile << std::endl;
+        return -1;
+    }
+
+    return rows.size();
+}
+
+/**
+ * @brief Checks whether a file starts like a pack file.
+ *
+ * @param path The path to the file.
+ * @return True if the file starts with the pack magic, false otherwise.
+ */
+bool FragmentPack::isPack(const std::string &path)
+{
+    char magic[sizeof(MAGIC)];
+    std::ifstream file(path, std::ios::binary);
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+/**
+ * @brief Unmaps the pack file.
+ */
+FragmentPack::~FragmentPack()
+{
+    if (this->data != nullptr)
+    {
+        munmap(const_cast<char *>(this->data), this->mappedSize);
+    }
+}
+
+/**
+ * @brief Maps a pack file and checks that its sections fit in the file.
+ *
+ * Only the header and the block table are checked here. The records of each range are
+ * checked by checkRecords, so that work is split between the clients.
+ *
+ * @param packFile The path to the pack file.
+ * @return True if the pack was mapped, false if it couldn't be opened or isn't valid.
+ */
+bool FragmentPack::open(const std::string &packFile)
+{
+    int fd = ::open(packFile.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        perror(("Opening pack file " + packFile + " failed").c_str());
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == -1 || static_cast<size_t>(info.st_size) < sizeof(PackHeader))
+    {
+        std::cerr << "Pack file is too small: " << packFile << std::endl;
+        close(fd);
+        return false;
+    }
+
+    // The mapping stays valid once the descriptor is closed
+    this->mappedSize = info.st_size;
+    void *mapped = mmap(nullptr, this->mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        perror(("Mapping pack file " + packFile + " failed").c_str());
+        return false;
+    }
+
+    // The clients read their ranges in parallel, so start reading the whole file in now
+    madvise(mapped, this->mappedSize, MADV_WILLNEED);
+
+    this->data = static_cast<const char *>(mapped);
+    this->header = reinterpret_cast<const PackHeader *>(this->data);
+    if (std::memcmp(this->header->magic, MAGIC, sizeof(MAGIC)) != 0 || this->header->version != VERSION)
+    {
+        std::cerr << "Not a version " << VERSION << " pack file: " << packFile << std::endl;
+        return false;
+    }
+
+    // Blocks are numbered by process index, which is an int
+    if (this->header->numBlocks > INT_MAX)
+    {
+        std::cerr << "Pack file has too many blocks: " << packFile << std::endl;
+        return false;
+    }
+
+    // Every section has to fit in the file exactly. Each one is checked against what is left
+    // of the file, so sizes that are large enough to wrap around when added up are caught
+    size_t remaining = this->mappedSize - sizeof(PackHeader);
+    size_t blockTableSize = (static_cast<size_t>(this->header->numBlocks) + 1) * sizeof(uint64_t);
+    if (blockTableSize > remaining)
+    {
+        std::cerr << "Pack file sections don't match its size: " << packFile << std::endl;
+        return false;
+    }
+    remaining -= blockTableSize;
+
+    if (this->header->numRecords > remaining / sizeof(PackRecord))
+    {
+        std::cerr << "Pack file sections don't match its size: " << packFile << std::endl;
+        return false;
+    }
+    size_t recordsSize = this->header->numRecords * sizeof(PackRecord);
+    remaining -= recordsSize;
+
+    if (this->header->textSize != remaining)
+    {
+        std::cerr << "Pack file sections don't match its size: " << packFile << std::endl;
+        return false;
+    }
+
+    this->blockStarts = reinterpret_cast<const uint64_t *>(this->data + sizeof(PackHeader));
+    this->records = reinterpret_cast<const PackRecord *>(this->data + sizeof(PackHeader) + blockTableSize);
+    this->text = this->data + sizeof(PackHeader) + blockTableSize + recordsSize;
+
+    // The blocks have to cover the records in order
+    for (uint32_t block = 0; block < this->header->numBlocks; block++)
+    {
+        if (this->blockStarts[block] > this->blockStarts[block + 1])
+        {
+            std::cerr << "Pack file block table is out of order: " << packFile << std::endl;
+            return false;
+        }
+    }
+
+    if (this->blockStarts[0] != 0 || this->blockStarts[this->header->numBlocks] != this->header->numRecords)
+    {
+        std::cerr << "Pack file block table doesn't cover the records: " << packFile << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Retrieves the number of blocks, one past the highest process index.
+ *
+ * @return The number of blocks.
+ */
+int FragmentPack::getNumBlocks() const
+{
+    return this->header->numBlocks;
+}
+
+/**
+ * @brief Retrieves the number of records.
+ *
+ * @return The number of records.
+ */
+size_t FragmentPack::size() const
+{
+    return this->header->numRecords;
+}
+
+/**
+ * @brief Retrieves the index of the first record of a block.
+ *
+ * @param block The process index of the block, or getNumBlocks() for the end of the records.
+ * @return The index of the block's first record.
+ */
+size_t FragmentPack::getBlockStart(int block) const
+{
+    return this->blockStarts[block];
+}
+
+/**
+ * @brief Checks that a range of records is ordered and that their code is in the text.
+ *
+ * @param startIdx The index of the first record.
+ * @param endIdx One past the index of the last record.
+ * @param report Set to the number of duplicate and missing line numbers in the range.
+ * @return True if the records are valid, false otherwise.
+ */
+bool FragmentPack::checkRecords(size_t startIdx, size_t endIdx, OrderReport &report) const
+{
+    report = {0, 0};
+    for (size_t i = startIdx; i < endIdx; i++)
+    {
+        const PackRecord &record = this->records[i];
+
+        // The record must sit in its block's range of the block table
+        if (record.processIdx < 0 || static_cast<uint32_t>(record.processIdx) >= this->header->numBlocks ||
+            i < this->blockStarts[record.processIdx] || i >= this->blockStarts[record.processIdx + 1])
+        {
+            return false;
+        }
+
+        // The code must follow the previous record's code and end with a newline
+        uint64_t expectedOffset = i == startIdx ? record.textOffset : this->records[i - 1].textOffset + this->records[i - 1].textLength + 1;
+        if (record.textOffset != expectedOffset || record.textOffset >= this->header->textSize ||
+            record.textLength >= this->header->textSize - record.textOffset ||
+            this->text[record.textOffset + record.textLength] != '\n')
+        {
+            return false;
+        }
+
+        if (i == startIdx || this->records[i - 1].processIdx != record.processIdx)
+        {
+            continue;
+        }
+
+        long long gap = static_cast<long long>(record.lineNum) - this->records[i - 1].lineNum;
+        if (gap < 0)
+        {
+            return false;
+        }
+        else if (gap == 0)
+        {
+            report.duplicateLines++;
+        }
+        else
+        {
+            report.missingLines += gap - 1;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Retrieves the code of a range of records, each line followed by a newline.
+ *
+ * @param startIdx The index of the first record.
+ * @param endIdx One past the index of the last record.
+ * @return A view of the block of code into the mapped file.
+ */
+std::string_view FragmentPack::getText(size_t startIdx, size_t endIdx) const
+{
+    if (startIdx >= endIdx)
+    {
+        return std::string_view();
+    }
+
+    const PackRecord &last = this->records[endIdx - 1];
+    uint64_t textStart = this->records[startIdx].textOffset;
+    return std::string_view(this->text + textStart, last.textOffset + last.textLength + 1 - textStart);
+}
@@ -0,0 +1,184 @@
+#ifndef FRAGMENT_PACK_H
+#define FRAGMENT_PACK_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "fragmentTable.h"
+
+/**
+ * @struct PackHeader
+ * @brief The start of a pack file, describing the size of every section after it.
+ */
+struct PackHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t numBlocks;
+    uint64_t numRecords;
+    uint64_t textSize;
+};
+
+/**
+ * @struct PackRecord
+ * @brief One fragment in a pack file. The code is a range of the text section.
+ */
+struct PackRecord
+{
+    int32_t processIdx;
+    int32_t lineNum;
+    uint32_t textLength;
+    uint32_t reserved;
+    uint64_t textOffset;
+};
+
+/**
+ * @brief A whole data set in one file, read through a single read-only mapping.
+ *
+ * A data folder holds one tiny file per fragment, so reading it costs an open, a read
+ * and a close per fragment. A pack holds the same fragments already parsed and ordered,
+ * so it costs one open and one mmap no matter how many fragments there are. It is laid
+ * out as:
+ * - The header.
+ * - The block table: the index of the first record of every block, plus one past the
+ *   last record, so a block's records are a contiguous range.
+ * - The records, ordered by (processIdx, lineNum).
+ * - The text: the code of every record, each followed by a newline, in record order.
+ *
+ * Since the text is in output order, the block of code of a range of records is just the
+ * slice of the text section those records cover, and is handed out without copying.
+ */
+class FragmentPack
+{
+public:
+    /**
+     * @brief Writes the fragments of a data folder into a pack file.
+     *
+     * The first line of every file is parsed, and files that can't be read or parsed, or
+     * that have a negative process index, are skipped. The fragments are ordered by
+     * (processIdx, lineNum) like the clients order them, so duplicate line numbers are
+     * kept in the order the files were listed.
+     *
+     * @param files The paths to the data files.
+     * @param packFile The path to the pack file to write.
+     * @param report Set to the number of duplicate and missing line numbers found.
+     * @return The number of fragments written, or -1 if the pack couldn't be written.
+     */
+    static long long write(const std::vector<std::string> &files, const std::string &packFile, OrderReport &report);
+
+    /**
+     * @brief Checks whether a file starts like a pack file.
+     *
+     * @param path The path to the file.
+     * @return True if the file starts with the pack magic, false otherwise.
+     */
+    static bool isPack(const std::string &path);
+
+    FragmentPack() = default;
+
+    /**
+     * @brief Unmaps the pack file.
+     */
+    ~FragmentPack();
+
+    FragmentPack(const FragmentPack &) = delete;
+    FragmentPack &operator=(const FragmentPack &) = delete;
+
+    /**
+     * @brief Maps a pack file and checks that its sections fit in the file.
+     *
+     * Only the header and the block table are checked here. The records of each range are
+     * checked by checkRecords, so that work is split between the clients.
+     *
+     * @param packFile The path to the pack file.
+     * @return True if the pack was mapped, false if it couldn't be opened or isn't valid.
+     */
+    bool open(const std::string &packFile);
+
+    /**
+     * @brief Retrieves the number of blocks, one past the highest process index.
+     *
+     * @return The number of blocks.
+     */
+    int getNumBlocks() const;
+
+    /**
+     * @brief Retrieves the number of records.
+     *
+     * @return The number of records.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Retrieves the index of the first record of a block.
+     *
+     * @param block The process index of the block, or getNumBlocks() for the end of the records.
+     * @return The index of the block's first record.
+     */
+    size_t getBlockStart(int block) const;
+
+    /**
+     * @brief Checks that a range of records is ordered and that their code is in the text.
+     *
+     * @param startIdx The index of the first record.
+     * @param endIdx One past the index of the last record.
+     * @param report Set to the number of duplicate and missing line numbers in the range.
+     * @return True if the records are valid, false otherwise.
+     */
+    bool checkRecords(size_t startIdx, size_t endIdx, OrderReport &report) const;
+
+    /**
+     * @brief Retrieves the code of a range of records, each line followed by a newline.
+     *
+     * @param startIdx The index of the first record.
+     * @param endIdx One past the index of the last record.
+     * @return A view of the block of code into the mapped file.
+     */
+    std::string_view getText(size_t startIdx, size_t endIdx) const;
+
+private:
+    /**
+     * The bytes every pack file starts with.
+     */
+    static constexpr char MAGIC[8] = {'P', '0', '5', 'P', 'A', 'C', 'K', '\0'};
+
+    /**
+     * The version of the layout written by write.
+     */
+    static constexpr uint32_t VERSION = 1;
+
+    /**
+     * The start of the mapped pack file.
+     */
+    const char *data = nullptr;
+
+    /**
+     * The size of the mapped pack file.
+     */
+    size_t mappedSize = 0;
+
+    /**
+     * The header, pointing into the mapped memory.
+     */
+    const PackHeader *header = nullptr;
+
+    /**
+     * The block table, pointing into the mapped memory.
+     */
+    const uint64_t *blockStarts = nullptr;
+
+    /**
+     * The records, pointing into the mapped memory.
+     */
+    const PackRecord *records = nullptr;
+
+    /**
+     * The text section, pointing into the mapped memory.
+     */
+    const char *text = nullptr;
+};
+
+#endif // FRAGMENT_PACK_H
@@ -0,0 +1,261 @@
+#include "fragmentParser.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FRAGMENT_PARSER_X86
+#endif
+
+namespace
+{
+    /**
+     * The number of '0' bytes in front of the header in a window, so the 8 bytes
+     * before the end of the first integer can always be loaded.
+     */
+    constexpr size_t WINDOW_PAD = 8;
+
+    /**
+     * The most digits an integer can have to be converted in a single 64-bit word.
+     */
+    constexpr size_t MAX_DIGITS = 8;
+
+    using ParseBatchFn = void (*)(const std::string_view *, size_t, FragmentView *, bool *);
+
+    /**
+     * @brief Parses the same batch as parseFragments one line at a time with parseFragment.
+     *
+     * @param lines The first line of every data file.
+     * @param count The number of lines.
+     * @param fragments Filled with one fragment per line.
+     * @param parsed Set to whether each line's integers were parsed.
+     */
+    void parseBatchScalar(const std::string_view *lines, size_t count, FragmentView *fragments, bool *parsed)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            parsed[i] = parseFragment(lines[i], fragments[i]);
+        }
+    }
+
+#ifdef FRAGMENT_PARSER_X86
+    /**
+     * @brief Converts up to eight ASCII digits into an integer.
+     *
+     * The 8 bytes that end with the last digit are loaded as one little-endian word,
+     * the bytes in front of the first digit are replaced with '0', and the digits are
+     * combined in pairs, then fours, then eights with three multiplications.
+     *
+     * @param end One past the last digit. The 8 bytes before it must be readable.
+     * @param numDigits The number of digits, from 1 to 8.
+     * @return The value of the digits.
+     */
+    inline int convertDigits(const char *end, size_t numDigits)
+    {
+        uint64_t word;
+        std::memcpy(&word, end - 8, sizeof(word));
+
+        // The low bytes come first in memory, so they are the ones in front of the digits
+        if (numDigits < 8)
+        {
+            uint64_t leading = (uint64_t(1) << (8 * (8 - numDigits))) - 1;
+            word = (word & ~leading) | (0x3030303030303030ULL & leading);
+        }
+
+        word = ((word & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+        word = ((word & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+        return static_cast<int>(((word & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);
+    }
+
+    /**
+     * @brief Copies the start of a line into a window the vector registers can load.
+     *
+     * The window is WINDOW_PAD '0' bytes, the first Width bytes of the line, then zeros
+     * if the line is shorter than Width.
+     *
+     * @tparam Width The number of bytes of the line that are looked at.
+     * @param line The line.
+     * @param window The window to fill, WINDOW_PAD + Width bytes.
+     */
+    template <size_t Width>
+    inline void fillWindow(std::string_view line, char *window)
+    {
+        size_t size = line.size() < Width ? line.size() : Width;
+        std::memset(window, '0', WINDOW_PAD);
+        std::memcpy(window + WINDOW_PAD, line.data(), size);
+        std::memset(window + WINDOW_PAD + size, 0, Width - size);
+    }
+
+    /**
+     * @brief Parses a header from the mask of which bytes of its window are digits.
+     *
+     * Only the common "<digits> <digits>" form is handled here. Anything else returns
+     * false so the caller can hand the line to parseFragment.
+     *
+     * @tparam Width The number of bytes of the line in the window.
+     * @param line The line.
+     * @param window The window filled by fillWindow.
+     * @param digitMask Bit i is set if byte i of the line is a digit.
+     * @param fragment The fragment to fill in.
+     * @return True if the header was parsed, false if it needs parseFragment.
+     */
+    template <size_t Width>
+    inline bool parseHeader(std::string_view line, const char *window, uint32_t digitMask, FragmentView &fragment)
+    {
+        const char *header = window + WINDOW_PAD;
+
+        // The process index starts right away and ends at a single space
+        size_t end1 = __builtin_ctzll(~static_cast<uint64_t>(digitMask));
+        if (end1 == 0 || end1 > MAX_DIGITS || end1 >= line.size() || header[end1] != ' ')
+        {
+            return false;
+        }
+
+        // The line number starts right after that space and must end inside the window
+        size_t start2 = end1 + 1;
+        uint64_t rest = ~(static_cast<uint64_t>(digitMask) >> start2);
+        size_t numDigits2 = __builtin_ctzll(rest);
+        size_t end2 = start2 + numDigits2;
+        if (numDigits2 == 0 || numDigits2 > MAX_DIGITS || end2 >= Width)
+        {
+            return false;
+        }
+
+        fragment.processIdx = convertDigits(header + end1, end1);
+        fragment.lineNum = convertDigits(header + end2, numDigits2);
+
+        // Skip the first space after the line number, the rest of the line is the code
+        size_t codeStart = end2 < line.size() && header[end2] == ' ' ? end2 + 1 : end2;
+        const char *code = line.data() + codeStart;
+        const char *newline = static_cast<const char *>(std::memchr(code, '\n', line.size() - codeStart));
+        size_t codeSize = newline != nullptr ? newline - code : line.size() - codeStart;
+        fragment.code = std::string_view(code, codeSize);
+        return true;
+    }
+
+    /**
+     * @brief Parses a batch of headers 16 bytes at a time with SSE2.
+     *
+     * @param lines The first line of every data file.
+     * @param count The number of lines.
+     * @param fragments Filled with one fragment per line.
+     * @param parsed Set to whether each line's integers were parsed.
+     */
+    __attribute__((target("sse2"))) void parseBatchSse2(const std::string_view *lines, size_t count, FragmentView *fragments, bool *parsed)
+    {
+        constexpr size_t width = 16;
+        alignas(16) char window[WINDOW_PAD + width];
+        const __m128i zero = _mm_set1_epi8('0');
+        const __m128i nine = _mm_set1_epi8(9);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            fillWindow<width>(lines[i], window);
+
+            // A byte is a digit if it is at most 9 after subtracting '0', as an unsigned byte
+            __m128i bytes = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(window + WINDOW_PAD)), zero);
+            __m128i digits = _mm_cmpeq_epi8(_mm_min_epu8(bytes, nine), bytes);
+            uint32_t digitMask = static_cast<uint32_t>(_mm_movemask_epi8(digits));
+
+            parsed[i] = parseHeader<width>(lines[i], window, digitMask, fragments[i]) || parseFragment(lines[i], fragments[i]);
+        }
+    }
+
+    /**
+     * @brief Parses a batch of headers 32 bytes at a time with AVX2.
+     *
+     * @param lines The first line of every data file.
+     * @param count The number of lines.
+     * @param fragments Filled with one fragment per line.
+     * @param parsed Set to whether each line's integers were parsed.
+     */
+    __attribute__((target("avx2"))) void parseBatchAvx2(const std::string_view *lines, size_t count, FragmentView *fragments, bool *parsed)
+    {
+        constexpr size_t width = 32;
+        alignas(32) char window[WINDOW_PAD + width];
+        const __m256i zero = _mm256_set1_epi8('0');
+        const __m256i nine = _mm256_set1_epi8(9);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            fillWindow<width>(lines[i], window);
+
+            // A byte is a digit if it is at most 9 after subtracting '0', as an unsigned byte
+            __m256i bytes = _mm256_sub_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(window + WINDOW_PAD)), zero);
+            __m256i digits = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, nine), bytes);
+            uint32_t digitMask = static_cast<uint32_t>(_mm256_movemask_epi8(digits));
+
+            parsed[i] = parseHeader<width>(lines[i], window, digitMask, fragments[i]) || parseFragment(lines[i], fragments[i]);
+        }
+    }
+#endif
+
+    /**
+     * @brief Picks the widest parser the CPU supports.
+     *
+     * @return The parser to use for every batch.
+     */
+    ParseBatchFn selectParser()
+    {
+#ifdef FRAGMENT_PARSER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return parseBatchAvx2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return parseBatchSse2;
+        }
+#endif
+        return parseBatchScalar;
+    }
+
+    /**
+     * The parser picked for this CPU, chosen once when the program starts.
+     */
+    const ParseBatchFn parseBatch = selectParser();
+}
+
+/**
+ * @brief Parses the first line of every data file in a batch.
+ *
+ * The header of each line (the process index, the line number, and the spaces around
+ * them) is loaded into a vector register, the digits are found with a single compare,
+ * and the delimiters fall out of the resulting bit mask. Each integer is then converted
+ * eight digits at a time inside a 64-bit word. The widest instruction set the CPU
+ * supports (AVX2, then SSE2) is picked once at startup, and any header the vector path
+ * can't handle on its own (leading whitespace, a sign, more than eight digits, or more
+ * than one space between the integers) goes through parseFragment instead, so the
+ * result is always the same as parseFragment's.
+ *
+ * @param lines The first line of every data file, with or without its newline.
+ * @param count The number of lines.
+ * @param fragments Filled with one fragment per line. The code is a view into the line.
+ * @param parsed Set to whether each line's integers were parsed.
+ */
+void parseFragments(const std::string_view *lines, size_t count, FragmentView *fragments, bool *parsed)
+{
+    parseBatch(lines, count, fragments, parsed);
+}
+
+/**
+ * @brief Retrieves the name of the instruction set parseFragments uses on this CPU.
+ *
+ * @return "avx2", "sse2", or "scalar".
+ */
+const char *getFragmentParserName()
+{
+#ifdef FRAGMENT_PARSER_X86
+    if (parseBatch == parseBatchAvx2)
+    {
+        return "avx2";
+    }
+    if (parseBatch == parseBatchSse2)
+    {
+        return "sse2";
+    }
+#endif
+    return "scalar";
+}
@@ -0,0 +1,35 @@
+#ifndef FRAGMENT_PARSER_H
+#define FRAGMENT_PARSER_H
+
+#include <string_view>
+#include <cstddef>
+
+#include "fragmentReader.h"
+
+/**
+ * @brief Parses the first line of every data file in a batch.
+ *
+ * The header of each line (the process index, the line number, and the spaces around
+ * them) is loaded into a vector register, the digits are found with a single compare,
+ * and the delimiters fall out of the resulting bit mask. Each integer is then converted
+ * eight digits at a time inside a 64-bit word. The widest instruction set the CPU
+ * supports (AVX2, then SSE2) is picked once at startup, and any header the vector path
+ * can't handle on its own (leading whitespace, a sign, more than eight digits, or more
+ * than one space between the integers) goes through parseFragment instead, so the
+ * result is always the same as parseFragment's.
+ *
+ * @param lines The first line of every data file, with or without its newline.
+ * @param count The number of lines.
+ * @param fragments Filled with one fragment per line. The code is a view into the line.
+ * @param parsed Set to whether each line's integers were parsed.
+ */
+void parseFragments(const std::string_view *lines, size_t count, FragmentView *fragments, bool *parsed);
+
+/**
+ * @brief Retrieves the name of the instruction set parseFragments uses on this CPU.
+ *
+ * @return "avx2", "sse2", or "scalar".
+ */
+const char *getFragmentParserName();
+
+#endif // FRAGMENT_PARSER_H
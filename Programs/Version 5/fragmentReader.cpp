@@ -0,0 +1,196 @@
+#include "fragmentReader.h"
+#include "fragmentParser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <memory>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief Parses a line in the "<processIdx> <lineNum> <code>" data file format.
+ *
+ * Whitespace before each integer is skipped, and a single space after the line number
+ * is dropped. Everything after that up to the end of the line is the code, including any
+ * leading whitespace or trailing carriage return.
+ *
+ * @param line The first line of a data file, with or without its newline.
+ * @param fragment The fragment to fill in. The code is a view into the line.
+ * @return True if both integers were parsed, false otherwise.
+ */
+bool parseFragment(std::string_view line, FragmentView &fragment)
+{
+    // Only the first line matters
+    size_t newlinePos = line.find('\n');
+    if (newlinePos != std::string_view::npos)
+    {
+        line = line.substr(0, newlinePos);
+    }
+
+    const char *pos = line.data();
+    const char *end = line.data() + line.size();
+
+    // Parse the two integers, skipping whitespace like operator>> would
+    int values[2];
+    for (int &value : values)
+    {
+        while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\v' || *pos == '\f'))
+        {
+            pos++;
+        }
+
+        std::from_chars_result result = std::from_chars(pos, end, value);
+        if (result.ec != std::errc())
+        {
+            return false;
+        }
+        pos = result.ptr;
+    }
+
+    // Skip the first space after the line number, the rest of the line is the code
+    if (pos < end && *pos == ' ')
+    {
+        pos++;
+    }
+
+    fragment.processIdx = values[0];
+    fragment.lineNum = values[1];
+    fragment.code = std::string_view(pos, end - pos);
+    return true;
+}
+
+/**
+ * @brief Reads and parses the first line of a data file.
+ *
+ * The file is read with pread into a buffer that is reused between calls, so reading
+ * a data file costs an open, a read, and a close, without any allocation once the
+ * buffer has grown to the size of the largest line.
+ *
+ * @param filename The path to the data file.
+ * @param fragment The fragment to fill in. The code is a view into the reader's buffer.
+ * @return True if the file could be read and parsed, false otherwise.
+ */
+bool FragmentReader::read(const std::string &filename, FragmentView &fragment)
+{
+    ssize_t bytesTotal = FragmentReader::readFirstLine(filename, this->buffer, 0);
+    if (bytesTotal == -1)
+    {
+        return false;
+    }
+
+    std::string_view line(this->buffer.data(), bytesTotal);
+    bool parsed;
+    parseFragments(&line, 1, &fragment, &parsed);
+    return parsed;
+}
+
+/**
+ * @brief Reads and parses the first line of a batch of data files.
+ *
+ * Every file's first line is read back to back into a buffer that is reused between
+ * calls, then the whole batch is parsed at once with parseFragments.
+ *
+ * @param filenames The paths to the data files.
+ * @param count The number of data files.
+ * @param fragments Filled with one fragment per file. The code is a view into the
+ *        reader's batch buffer, valid until the next call to readBatch.
+ * @param parsed Set to whether each file could be read and parsed.
+ */
+void FragmentReader::readBatch(const std::string *filenames, size_t count, std::vector<FragmentView> &fragments, std::vector<bool> &parsed)
+{
+    // The buffer may grow while the batch is read, so only remember where each line starts
+    std::vector<size_t> lineStarts(count + 1);
+    std::vector<bool> readable(count);
+    size_t bytesTotal = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        lineStarts[i] = bytesTotal;
+        ssize_t bytesRead = FragmentReader::readFirstLine(filenames[i], this->batchBuffer, bytesTotal);
+        readable[i] = bytesRead != -1;
+        if (readable[i])
+        {
+            bytesTotal += bytesRead;
+        }
+    }
+    lineStarts[count] = bytesTotal;
+
+    std::vector<std::string_view> lines(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        lines[i] = std::string_view(this->batchBuffer.data() + lineStarts[i], lineStarts[i + 1] - lineStarts[i]);
+    }
+
+    fragments.resize(count);
+    std::unique_ptr<bool[]> linesParsed(new bool[count]);
+    parseFragments(lines.data(), count, fragments.data(), linesParsed.get());
+
+    parsed.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        parsed[i] = readable[i] && linesParsed[i];
+    }
+}
+
+/**
+ * @brief Reads the first line of a data file into a buffer.
+ *
+ * The file is read with pread starting at the given offset of the buffer, which is
+ * grown if the first line doesn't fit.
+ *
+ * @param filename The path to the data file.
+ * @param buffer The buffer to read into.
+ * @param start The offset in the buffer to read to.
+ * @return The number of bytes read up to and including the first newline, or -1 if
+ *         the file couldn't be read.
+ */
+ssize_t FragmentReader::readFirstLine(const std::string &filename, std::vector<char> &buffer, size_t start)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    // Keep reading until the first newline or the end of the file, growing the buffer
+    // only if the first line doesn't fit
+    const size_t minSpace = 4096;
+    if (buffer.size() < start + minSpace)
+    {
+        buffer.resize(std::max(buffer.size() * 2, start + minSpace));
+    }
+
+    size_t bytesTotal = 0;
+    while (true)
+    {
+        char *readPos = buffer.data() + start + bytesTotal;
+        ssize_t bytesRead = pread(fd, readPos, buffer.size() - start - bytesTotal, bytesTotal);
+        if (bytesRead == -1)
+        {
+            close(fd);
+            return -1;
+        }
+
+        const char *newline = static_cast<const char *>(memchr(readPos, '\n', bytesRead));
+        if (newline != nullptr)
+        {
+            // Everything after the first line is dropped so the next line can go right after it
+            bytesTotal = newline + 1 - (buffer.data() + start);
+            break;
+        }
+
+        bytesTotal += bytesRead;
+        if (bytesRead == 0)
+        {
+            break;
+        }
+
+        if (start + bytesTotal == buffer.size())
+        {
+            buffer.resize(buffer.size() * 2);
+        }
+    }
+
+    close(fd);
+    return bytesTotal;
+}
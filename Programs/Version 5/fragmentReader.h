@@ -0,0 +1,98 @@
+#ifndef FRAGMENT_READER_H
+#define FRAGMENT_READER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <sys/types.h>
+
+/**
+ * @struct FragmentView
+ * @brief A parsed data file line that points into the reader's buffer.
+ *
+ * The code is a view into the buffer of the FragmentReader that produced it, so it is
+ * only valid until the next call to read on that reader.
+ */
+struct FragmentView
+{
+    int processIdx;
+    int lineNum;
+    std::string_view code;
+};
+
+/**
+ * @brief Parses a line in the "<processIdx> <lineNum> <code>" data file format.
+ *
+ * Whitespace before each integer is skipped, and a single space after the line number
+ * is dropped. Everything after that up to the end of the line is the code, including any
+ * leading whitespace or trailing carriage return.
+ *
+ * @param line The first line of a data file, with or without its newline.
+ * @param fragment The fragment to fill in. The code is a view into the line.
+ * @return True if both integers were parsed, false otherwise.
+ */
+bool parseFragment(std::string_view line, FragmentView &fragment);
+
+class FragmentReader
+{
+public:
+    /**
+     * @brief Reads and parses the first line of a data file.
+     *
+     * The file is read with pread into a buffer that is reused between calls, so reading
+     * a data file costs an open, a read, and a close, without any allocation once the
+     * buffer has grown to the size of the largest line.
+     *
+     * @param filename The path to the data file.
+     * @param fragment The fragment to fill in. The code is a view into the reader's buffer.
+     * @return True if the file could be read and parsed, false otherwise.
+     */
+    bool read(const std::string &filename, FragmentView &fragment);
+
+    /**
+     * @brief Reads and parses the first line of a batch of data files.
+     *
+     * Every file's first line is read back to back into a buffer that is reused between
+     * calls, then the whole batch is parsed at once with parseFragments.
+     *
+     * @param filenames The paths to the data files.
+     * @param count The number of data files.
+     * @param fragments Filled with one fragment per file. The code is a view into the
+     *        reader's batch buffer, valid until the next call to readBatch.
+     * @param parsed Set to whether each file could be read and parsed.
+     */
+    void readBatch(const std::string *filenames, size_t count, std::vector<FragmentView> &fragments, std::vector<bool> &parsed);
+
+    /**
+     * The number of data files a caller should read with each call to readBatch.
+     */
+    static constexpr size_t BATCH_SIZE = 256;
+
+private:
+    /**
+     * The buffer the files are read into, kept between calls.
+     */
+    std::vector<char> buffer = std::vector<char>(4096);
+
+    /**
+     * The buffer the first lines of a batch are read into, kept between calls.
+     */
+    std::vector<char> batchBuffer;
+
+    /**
+     * @brief Reads the first line of a data file into a buffer.
+     *
+     * The file is read with pread starting at the given offset of the buffer, which is
+     * grown if the first line doesn't fit.
+     *
+     * @param filename The path to the data file.
+     * @param buffer The buffer to read into.
+     * @param start The offset in the buffer to read to.
+     * @return The number of bytes read up to and including the first newline, or -1 if
+     *         the file couldn't be read.
+     */
+    static ssize_t readFirstLine(const std::string &filename, std::vector<char> &buffer, size_t start);
+};
+
+#endif // FRAGMENT_READER_H
@@ -0,0 +1,301 @@
+#include "fragmentTable.h"
+
+#include <algorithm>
+#include <climits>
+
+/**
+ * @brief Reserves room for a number of rows and bytes of code.
+ *
+ * @param numRows The number of rows to make room for.
+ * @param textSize The number of bytes of code to make room for.
+ */
+void FragmentTable::reserve(size_t numRows, size_t textSize)
+{
+    this->processIdx.reserve(numRows);
+    this->lineNum.reserve(numRows);
+    this->textOffset.reserve(numRows);
+    this->textLength.reserve(numRows);
+    this->text.reserve(textSize);
+}
+
+/**
+ * @brief Adds a row, copying its code to the end of the text blob.
+ *
+ * @param processIdx The process index of the line.
+ * @param lineNum The line number of the line.
+ * @param code The code of the line.
+ */
+void FragmentTable::append(int processIdx, int lineNum, std::string_view code)
+{
+    this->appendSpan(processIdx, lineNum, this->text.size(), code.size());
+    this->text.append(code);
+}
+
+/**
+ * @brief Moves every row of another table to the end of this one.
+ *
+ * @param other The table to take the rows from. It is left empty.
+ */
+void FragmentTable::append(FragmentTable &other)
+{
+    // The other table's code lands after this table's, so its offsets move up by as much
+    size_t base = this->text.size();
+    for (size_t row = 0; row < other.size(); row++)
+    {
+        this->appendSpan(other.processIdx[row], other.lineNum[row], base + other.textOffset[row], other.textLength[row]);
+    }
+    this->text.append(other.text);
+
+    other.clear();
+}
+
+/**
+ * @brief Adds a row whose code is already in the text blob.
+ *
+ * Used together with adoptText to build a table around a buffer the code was
+ * received into, without copying the code.
+ *
+ * @param processIdx The process index of the line.
+ * @param lineNum The line number of the line.
+ * @param textOffset The offset of the code in the text blob.
+ * @param textLength The length of the code.
+ */
+void FragmentTable::appendSpan(int processIdx, int lineNum, size_t textOffset, size_t textLength)
+{
+    this->processIdx.push_back(processIdx);
+    this->lineNum.push_back(lineNum);
+    this->textOffset.push_back(textOffset);
+    this->textLength.push_back(static_cast<uint32_t>(textLength));
+}
+
+/**
+ * @brief Replaces the text blob with a buffer the rows' code already lives in.
+ *
+ * @param text The new text blob.
+ */
+void FragmentTable::adoptText(std::string &&text)
+{
+    this->text = std::move(text);
+}
+
+/**
+ * @brief Retrieves the number of rows.
+ *
+ * @return The number of rows.
+ */
+size_t FragmentTable::size() const
+{
+    return this->processIdx.size();
+}
+
+/**
+ * @brief Retrieves the total number of bytes of code.
+ *
+ * @return The size of the text blob.
+ */
+size_t FragmentTable::textSize() const
+{
+    return this->text.size();
+}
+
+/**
+ * @brief Removes every row and the text blob.
+ */
+void FragmentTable::clear()
+{
+    this->processIdx.clear();
+    this->lineNum.clear();
+    this->textOffset.clear();
+    this->textLength.clear();
+    this->text.clear();
+}
+
+/**
+ * @brief Retrieves the process index column.
+ *
+ * @return The process index of every row.
+ */
+const std::vector<int> &FragmentTable::getProcessIdx() const
+{
+    return this->processIdx;
+}
+
+/**
+ * @brief Retrieves the line number column.
+ *
+ * @return The line number of every row.
+ */
+const std::vector<int> &FragmentTable::getLineNums() const
+{
+    return this->lineNum;
+}
+
+/**
+ * @brief Retrieves the code of a row.
+ *
+ * @param row The index of the row.
+ * @return A view of the row's code in the text blob.
+ */
+std::string_view FragmentTable::getCode(size_t row) const
+{
+    return std::string_view(this->text).substr(this->textOffset[row], this->textLength[row]);
+}
+
+/**
+ * @brief Finds the order of the rows by (processIdx, lineNum).
+ *
+ * Only the process index and line number columns are read.
+ *
+ * @param rows Filled with the row indices in order.
+ * @return The number of duplicate and missing line numbers that were found.
+ */
+OrderReport FragmentTable::order(std::vector<uint32_t> &rows) const
+{
+    return FragmentTable::orderRows(this->processIdx, this->lineNum, rows);
+}
+
+/**
+ * @brief Joins the code of the given rows into a block, each followed by a newline.
+ *
+ * @param rows The row indices in the order the code is joined.
+ * @return The block of code.
+ */
+std::string FragmentTable::join(const std::vector<uint32_t> &rows) const
+{
+    // Size the block once, then copy each row's code straight out of the text blob
+    size_t blockSize = 0;
+    for (uint32_t row : rows)
+    {
+        blockSize += this->textLength[row] + 1;
+    }
+
+    std::string block;
+    block.reserve(blockSize);
+    for (uint32_t row : rows)
+    {
+        block.append(this->text, this->textOffset[row], this->textLength[row]);
+        block.push_back('\n');
+    }
+
+    return block;
+}
+
+/**
+ * @brief Finds the order of rows by (processIdx, lineNum) from the two integer columns.
+ *
+ * Line numbers are usually dense, so each block's rows fill a range of slots from its
+ * lowest to its highest line number, and every row index is dropped straight into its
+ * slot. If the slots would be mostly empty, or two rows share a slot, the function
+ * falls back to sorting small (processIdx, lineNum, index) keys.
+ *
+ * @param processIdx The process index of every row.
+ * @param lineNum The line number of every row.
+ * @param rows Filled with the row indices in order.
+ * @return The number of duplicate and missing line numbers that were found.
+ */
+OrderReport FragmentTable::orderRows(const std::vector<int> &processIdx, const std::vector<int> &lineNum, std::vector<uint32_t> &rows)
+{
+    OrderReport report = {0, 0};
+    size_t numRows = processIdx.size();
+    rows.clear();
+    if (numRows == 0)
+    {
+        return report;
+    }
+
+    // Find the range of line numbers in each block the rows belong to
+    auto [minProc, maxProc] = std::minmax_element(processIdx.begin(), processIdx.end());
+    int firstBlock = *minProc;
+    size_t numBlocks = static_cast<size_t>(*maxProc) - firstBlock + 1;
+
+    std::vector<long long> minLine(numBlocks, LLONG_MAX);
+    std::vector<long long> maxLine(numBlocks, LLONG_MIN);
+    for (size_t i = 0; i < numRows; i++)
+    {
+        size_t block = processIdx[i] - firstBlock;
+        minLine[block] = std::min<long long>(minLine[block], lineNum[i]);
+        maxLine[block] = std::max<long long>(maxLine[block], lineNum[i]);
+    }
+
+    // Lay the blocks' slots out one after the other
+    std::vector<size_t> slotBase(numBlocks);
+    size_t numSlots = 0;
+    for (size_t block = 0; block < numBlocks; block++)
+    {
+        slotBase[block] = numSlots;
+        if (minLine[block] <= maxLine[block])
+        {
+            numSlots += maxLine[block] - minLine[block] + 1;
+        }
+    }
+
+    // Dense line numbers: drop every row straight into its slot
+    if (numSlots <= MAX_SLOTS_PER_LINE * numRows)
+    {
+        std::vector<uint32_t> slots(numSlots, UINT32_MAX);
+        bool collision = false;
+        for (size_t i = 0; i < numRows; i++)
+        {
+            size_t block = processIdx[i] - firstBlock;
+            uint32_t &slot = slots[slotBase[block] + (lineNum[i] - minLine[block])];
+            if (slot != UINT32_MAX)
+            {
+                collision = true;
+                break;
+            }
+            slot = i;
+        }
+
+        // Two rows sharing a slot can't both be placed, so sort the keys instead
+        if (!collision)
+        {
+            rows.reserve(numRows);
+            for (uint32_t row : slots)
+            {
+                if (row != UINT32_MAX)
+                {
+                    rows.push_back(row);
+                }
+            }
+
+            report.missingLines = numSlots - numRows;
+            return report;
+        }
+    }
+
+    // Sparse or duplicate line numbers: sort small keys
+    struct RowKey
+    {
+        int processIdx;
+        int lineNum;
+        uint32_t row;
+    };
+
+    std::vector<RowKey> keys(numRows);
+    for (size_t i = 0; i < numRows; i++)
+    {
+        keys[i] = {processIdx[i], lineNum[i], static_cast<uint32_t>(i)};
+    }
+
+    std::sort(keys.begin(), keys.end(), [](const RowKey &a, const RowKey &b)
+              { return a.processIdx != b.processIdx ? a.processIdx < b.processIdx : a.lineNum != b.lineNum ? a.lineNum < b.lineNum
+                                                                                                           : a.row < b.row; });
+
+    rows.reserve(numRows);
+    size_t distinctLines = 0;
+    for (size_t i = 0; i < numRows; i++)
+    {
+        if (i > 0 && keys[i].processIdx == keys[i - 1].processIdx && keys[i].lineNum == keys[i - 1].lineNum)
+        {
+            report.duplicateLines++;
+        }
+        else
+        {
+            distinctLines++;
+        }
+        rows.push_back(keys[i].row);
+    }
+
+    report.missingLines = numSlots - distinctLines;
+    return report;
+}
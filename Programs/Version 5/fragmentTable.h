@@ -0,0 +1,186 @@
+#ifndef FRAGMENT_TABLE_H
+#define FRAGMENT_TABLE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @struct OrderReport
+ * @brief What FragmentTable::orderRows found out about the line numbers while ordering.
+ *
+ * A missing line is a line number between the first and last line of a block that
+ * no data file had.
+ */
+struct OrderReport
+{
+    size_t duplicateLines;
+    size_t missingLines;
+};
+
+/**
+ * @brief Parsed data file lines stored column by column.
+ *
+ * Each column holds one field of every row: the process index, the line number, and
+ * the offset and length of the code in a single text blob. The stages that only look at
+ * the integers (finding a line's owner, ordering the lines) walk one or two tightly
+ * packed columns instead of striding over records that each point to their own string,
+ * and the code itself is only touched when the block is joined.
+ */
+class FragmentTable
+{
+public:
+    /**
+     * @brief Reserves room for a number of rows and bytes of code.
+     *
+     * @param numRows The number of rows to make room for.
+     * @param textSize The number of bytes of code to make room for.
+     */
+    void reserve(size_t numRows, size_t textSize);
+
+    /**
+     * @brief Adds a row, copying its code to the end of the text blob.
+     *
+     * @param processIdx The process index of the line.
+     * @param lineNum The line number of the line.
+     * @param code The code of the line.
+     */
+    void append(int processIdx, int lineNum, std::string_view code);
+
+    /**
+     * @brief Moves every row of another table to the end of this one.
+     *
+     * @param other The table to take the rows from. It is left empty.
+     */
+    void append(FragmentTable &other);
+
+    /**
+     * @brief Adds a row whose code is already in the text blob.
+     *
+     * Used together with adoptText to build a table around a buffer the code was
+     * received into, without copying the code.
+     *
+     * @param processIdx The process index of the line.
+     * @param lineNum The line number of the line.
+     * @param textOffset The offset of the code in the text blob.
+     * @param textLength The length of the code.
+     */
+    void appendSpan(int processIdx, int lineNum, size_t textOffset, size_t textLength);
+
+    /**
+     * @brief Replaces the text blob with a buffer the rows' code already lives in.
+     *
+     * @param text The new text blob.
+     */
+    void adoptText(std::string &&text);
+
+    /**
+     * @brief Retrieves the number of rows.
+     *
+     * @return The number of rows.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Retrieves the total number of bytes of code.
+     *
+     * @return The size of the text blob.
+     */
+    size_t textSize() const;
+
+    /**
+     * @brief Removes every row and the text blob.
+     */
+    void clear();
+
+    /**
+     * @brief Retrieves the process index column.
+     *
+     * @return The process index of every row.
+     */
+    const std::vector<int> &getProcessIdx() const;
+
+    /**
+     * @brief Retrieves the line number column.
+     *
+     * @return The line number of every row.
+     */
+    const std::vector<int> &getLineNums() const;
+
+    /**
+     * @brief Retrieves the code of a row.
+     *
+     * @param row The index of the row.
+     * @return A view of the row's code in the text blob.
+     */
+    std::string_view getCode(size_t row) const;
+
+    /**
+     * @brief Finds the order of the rows by (processIdx, lineNum).
+     *
+     * Only the process index and line number columns are read.
+     *
+     * @param rows Filled with the row indices in order.
+     * @return The number of duplicate and missing line numbers that were found.
+     */
+    OrderReport order(std::vector<uint32_t> &rows) const;
+
+    /**
+     * @brief Joins the code of the given rows into a block, each followed by a newline.
+     *
+     * @param rows The row indices in the order the code is joined.
+     * @return The block of code.
+     */
+    std::string join(const std::vector<uint32_t> &rows) const;
+
+    /**
+     * @brief Finds the order of rows by (processIdx, lineNum) from the two integer columns.
+     *
+     * Line numbers are usually dense, so each block's rows fill a range of slots from its
+     * lowest to its highest line number, and every row index is dropped straight into its
+     * slot. If the slots would be mostly empty, or two rows share a slot, the function
+     * falls back to sorting small (processIdx, lineNum, index) keys.
+     *
+     * @param processIdx The process index of every row.
+     * @param lineNum The line number of every row.
+     * @param rows Filled with the row indices in order.
+     * @return The number of duplicate and missing line numbers that were found.
+     */
+    static OrderReport orderRows(const std::vector<int> &processIdx, const std::vector<int> &lineNum, std::vector<uint32_t> &rows);
+
+private:
+    /**
+     * The most slots per row for which orderRows still places rows directly. Past
+     * this, the line numbers are too sparse and sorting the keys is cheaper.
+     */
+    static constexpr size_t MAX_SLOTS_PER_LINE = 2;
+
+    /**
+     * The process index of every row.
+     */
+    std::vector<int> processIdx;
+
+    /**
+     * The line number of every row.
+     */
+    std::vector<int> lineNum;
+
+    /**
+     * Where the code of every row starts in the text.
+     */
+    std::vector<size_t> textOffset;
+
+    /**
+     * The length of the code of every row.
+     */
+    std::vector<uint32_t> textLength;
+
+    /**
+     * The code of every row, back to back.
+     */
+    std::string text;
+};
+
+#endif // FRAGMENT_TABLE_H
@@ -7,29 +7,76 @@
 
 int main(int argc, char *argv[])
 {
-    if (argc < 4)
+    if (argc < 3)
     {
-        std::cerr << "Usage: " << argv[0] << " <highestProcessIdx> <dataFolder> <outputFile>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <dataFolder> <outputFile> [--engine=processes|threads|streaming|global] [--workers=N] [--trace=<traceFile>]" << std::endl;
         return 26;
     }
 
-    else if (argc > 4)
+    else if (argc > 6)
     {
-        std::cerr << "Usage: " << argv[0] << " <highestProcessIdx> <dataFolder> <outputFile>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <dataFolder> <outputFile> [--engine=processes|threads|streaming|global] [--workers=N] [--trace=<traceFile>]" << std::endl;
         return 27;
     }
 
-    // First argument contains the highest process index
-    // Add 1 to represent the number of clients
-    // Script running the program has already verified that the highest process index is an integer
-    int numClients = std::stoi(argv[1]) + 1;
-
-    // Second argument contains the path to the data folder
+    // First argument contains the path to the data folder, or to a pack file made from one
+    // by the pack program
     // Script running the program has already verified that the data folder exists
-    std::string dataFolder = argv[2];
+    std::string dataFolder = argv[1];
+
+    // Second argument contains the path to the output file
+    std::string outputFile = argv[2];
+
+    // Optional arguments select how the clients are run: a distributor and processor
+    // process per client (the default), tasks on a pool of threads in this process, or the
+    // same pool with every fragment routed straight to its owner while the files are scanned,
+    // or the same pool placing every fragment at its global line number.
+    // The number of workers caps how many clients are created; by default it is the
+    // number of cores, and each client then handles several process indices.
+    // A trace file asks for the time spent in every phase of every process to be written
+    // out as Chrome trace events.
+    std::string engine = "processes";
+    int numWorkers = 0;
+    std::string traceFile;
+    for (int i = 3; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option.rfind("--engine=", 0) == 0)
+        {
+            engine = option.substr(std::string("--engine=").size());
+            if (engine != "processes" && engine != "threads" && engine != "streaming" && engine != "global")
+            {
+                std::cerr << "Unknown engine: " << engine << std::endl;
+                return 28;
+            }
+        }
+        else if (option.rfind("--workers=", 0) == 0)
+        {
+            try
+            {
+                numWorkers = std::stoi(option.substr(std::string("--workers=").size()));
+            }
+            catch (const std::exception &)
+            {
+                numWorkers = -1;
+            }
 
-    // Third argument contains the path to the output file
-    std::string outputFile = argv[3];
+            if (numWorkers < 1)
+            {
+                std::cerr << "Invalid number of workers: " << option << std::endl;
+                return 29;
+            }
+        }
+        else if (option.rfind("--trace=", 0) == 0)
+        {
+            traceFile = option.substr(std::string("--trace=").size());
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 28;
+        }
+    }
 
 #ifdef DEBUG
     // Clear the debug folder of old logs
@@ -39,6 +86,14 @@ int main(int argc, char *argv[])
     std::filesystem::create_directory("./Debug");
 #endif
 
+    // The distributors and processors find out about the trace through the environment,
+    // so it has to be enabled before they are launched
+    PhaseTrace::setProcessName("server");
+    if (!traceFile.empty() && !PhaseTrace::enable(traceFile))
+    {
+        traceFile.clear();
+    }
+
     // Each data file represents a line in a block of code. The line contains
     // the index of the process or "block" it belongs to. The server will distribute
     // the data files to the distributor processes based on this index.
@@ -46,11 +101,35 @@ int main(int argc, char *argv[])
     // line of code itself.
 
     // Launch the server process
-    Server server(numClients);
+    Server server(numWorkers);
+
+    // A pack file is already parsed and in order, so it is rebuilt straight from the mapped
+    // file whatever the engine, and none of the stages below that handle files are needed
+    bool packed = std::filesystem::is_regular_file(dataFolder) && FragmentPack::isPack(dataFolder);
+    if (!packed && !std::filesystem::is_directory(dataFolder))
+    {
+        std::cerr << "Data folder does not exist or is not a pack file: " << dataFolder << std::endl;
+        return 30;
+    }
+
+    // Get all the data files from the specified folder. The highest process index found
+    // in the files determines the number of blocks, so the server creates the clients here.
+    std::vector<std::string> dataFiles;
+    if (packed)
+    {
+        server.openDataPack(dataFolder);
+    }
+    else
+    {
+        dataFiles = server.getAllDataFiles(dataFolder);
+    }
+    std::cout << "Launching server process with " << server.getNumClients() << " workers for " << server.getNumBlocks() << " processes" << std::endl;
 
-    // Get all the data files from the specified folder and distribute them among the clients
-    std::vector<std::string> dataFiles = server.getAllDataFiles(dataFolder);
-    server.distributeDataFiles(dataFiles);
+    // Distribute the data files among the clients
+    if (!packed)
+    {
+        server.distributeDataFiles(dataFiles);
+    }
 
     // We then need to verify that the data files have been distributed correctly
     // meaning that each distributor process has received the data files that belong
@@ -62,10 +141,38 @@ int main(int argc, char *argv[])
     // It will finally combine the lines back into a block of code.
     // This step is handeled by the client distributor process, not the server.
 
-    std::string reconstructedCode = server.initializeDistributor(dataFiles);
+    if (packed)
+    {
+        // Each client's block is a slice of the pack, written out without being copied
+        server.writeOutputFile(outputFile, server.runPackEngine());
+    }
+    else if (engine == "threads")
+    {
+        // Run every stage in this process on a pool of threads instead, then the server
+        // outputs the reconstructed program to a file
+        server.writeOutputFile(outputFile, server.runThreadedEngine(dataFiles));
+    }
+    else if (engine == "streaming")
+    {
+        // Skip the verification barrier and send each fragment to its owner right away
+        server.writeOutputFile(outputFile, server.runStreamingEngine(dataFiles));
+    }
+    else if (engine == "global")
+    {
+        // Ignore the blocks and put every fragment at its line number in the whole program
+        server.writeOutputFile(outputFile, server.runGlobalEngine(dataFiles));
+    }
+    else
+    {
+        // The processors write their blocks straight into the output file
+        server.initializeDistributor(dataFiles, outputFile);
+    }
 
-    // Lastly, the server outputs the reconstructed program to a file.
-    server.writeOutputFile(outputFile, reconstructedCode);
+    // Every child process has exited by now, so their records are all in
+    if (!traceFile.empty() && PhaseTrace::writeChromeTrace())
+    {
+        std::cout << "Wrote the trace to " << traceFile << std::endl;
+    }
 
     return 0;
 }
@@ -0,0 +1,122 @@
+#include "manifest.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Writes the file paths into a new memory file.
+ *
+ * The returned file descriptor is not close-on-exec so it can be handed to the
+ * distributor and processor programs.
+ *
+ * @param files The file paths to write to the manifest.
+ * @return The file descriptor of the memory file.
+ */
+int Manifest::create(const std::vector<std::string> &files)
+{
+    uint64_t numFiles = files.size();
+    size_t headerSize = sizeof(uint64_t) * (numFiles + 2);
+
+    size_t totalSize = headerSize;
+    for (const auto &file : files)
+    {
+        totalSize += file.size();
+    }
+
+    int fd = memfd_create("manifest", 0);
+    if (fd == -1 || ftruncate(fd, totalSize) == -1)
+    {
+        perror("Creating manifest failed");
+        exit(180);
+    }
+
+    char *data = static_cast<char *>(mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    if (data == MAP_FAILED)
+    {
+        perror("Mapping manifest failed");
+        exit(181);
+    }
+
+    // Write the number of files, then the offset table, then the paths themselves
+    uint64_t *header = reinterpret_cast<uint64_t *>(data);
+    header[0] = numFiles;
+
+    uint64_t offset = headerSize;
+    for (size_t i = 0; i < numFiles; i++)
+    {
+        header[i + 1] = offset;
+        std::memcpy(data + offset, files[i].data(), files[i].size());
+        offset += files[i].size();
+    }
+    header[numFiles + 1] = offset;
+
+    munmap(data, totalSize);
+    return fd;
+}
+
+/**
+ * @brief Maps a manifest created by Manifest::create.
+ *
+ * @param fd The file descriptor of the memory file.
+ */
+Manifest::Manifest(int fd)
+{
+    struct stat info;
+    if (fstat(fd, &info) == -1)
+    {
+        perror("Reading manifest size failed");
+        exit(182);
+    }
+
+    this->mappedSize = info.st_size;
+    void *mapped = mmap(nullptr, this->mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        perror("Mapping manifest failed");
+        exit(183);
+    }
+
+    this->data = static_cast<const char *>(mapped);
+    this->numFiles = reinterpret_cast<const uint64_t *>(this->data)[0];
+    this->offsets = reinterpret_cast<const uint64_t *>(this->data) + 1;
+}
+
+/**
+ * @brief Unmaps the manifest. The file descriptor is left open.
+ */
+Manifest::~Manifest()
+{
+    munmap(const_cast<char *>(this->data), this->mappedSize);
+}
+
+/**
+ * @brief Retrieves the number of file paths in the manifest.
+ *
+ * @return The number of file paths.
+ */
+size_t Manifest::size() const
+{
+    return this->numFiles;
+}
+
+/**
+ * @brief Retrieves the file path at the specified index.
+ *
+ * @param index The index of the file path, in the order the server listed them.
+ * @return A view of the file path into the mapped memory.
+ *
+ * @throws std::out_of_range if the index is out of bounds.
+ */
+std::string_view Manifest::getFile(size_t index) const
+{
+    if (index >= this->numFiles)
+    {
+        throw std::out_of_range("Index out of range");
+    }
+
+    return std::string_view(this->data + this->offsets[index], this->offsets[index + 1] - this->offsets[index]);
+}
@@ -0,0 +1,87 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief A read-only list of data file paths shared between processes through a memfd.
+ *
+ * The server writes every file path once into an anonymous memory file, and each child
+ * process only needs the file descriptor (which survives exec) to map the same list.
+ * This keeps the exec arguments a constant size no matter how many data files there are.
+ *
+ * The memory file is laid out as the number of paths, an offset table with one more
+ * entry than there are paths, and then the path bytes back to back.
+ */
+class Manifest
+{
+public:
+    /**
+     * @brief Writes the file paths into a new memory file.
+     *
+     * The returned file descriptor is not close-on-exec so it can be handed to the
+     * distributor and processor programs.
+     *
+     * @param files The file paths to write to the manifest.
+     * @return The file descriptor of the memory file.
+     */
+    static int create(const std::vector<std::string> &files);
+
+    /**
+     * @brief Maps a manifest created by Manifest::create.
+     *
+     * @param fd The file descriptor of the memory file.
+     */
+    Manifest(int fd);
+
+    /**
+     * @brief Unmaps the manifest. The file descriptor is left open.
+     */
+    ~Manifest();
+
+    Manifest(const Manifest &) = delete;
+    Manifest &operator=(const Manifest &) = delete;
+
+    /**
+     * @brief Retrieves the number of file paths in the manifest.
+     *
+     * @return The number of file paths.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Retrieves the file path at the specified index.
+     *
+     * @param index The index of the file path, in the order the server listed them.
+     * @return A view of the file path into the mapped memory.
+     *
+     * @throws std::out_of_range if the index is out of bounds.
+     */
+    std::string_view getFile(size_t index) const;
+
+private:
+    /**
+     * The start of the mapped memory file.
+     */
+    const char *data;
+
+    /**
+     * The size of the mapped memory file.
+     */
+    size_t mappedSize;
+
+    /**
+     * The number of file paths in the manifest.
+     */
+    uint64_t numFiles;
+
+    /**
+     * The offset table, pointing into the mapped memory.
+     */
+    const uint64_t *offsets;
+};
+
+#endif // MANIFEST_H
@@ -0,0 +1,52 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "fragmentPack.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <dataFolder> <packFile>" << std::endl;
+        return 26;
+    }
+
+    // First argument contains the path to the data folder to pack
+    std::string dataFolder = argv[1];
+
+    // Second argument contains the path to the pack file, which version 5 takes in place of the folder
+    std::string packFile = argv[2];
+
+    std::error_code error;
+    std::vector<std::string> files;
+    for (const auto &entry : std::filesystem::directory_iterator(dataFolder, error))
+    {
+        if (entry.is_regular_file())
+        {
+            files.push_back(entry.path().string());
+        }
+    }
+
+    if (error)
+    {
+        std::cerr << "Failed to read data folder " << dataFolder << ": " << error.message() << std::endl;
+        return 2;
+    }
+
+    OrderReport report;
+    long long numFragments = FragmentPack::write(files, packFile, report);
+    if (numFragments < 0)
+    {
+        return 3;
+    }
+
+    if (report.duplicateLines > 0 || report.missingLines > 0)
+    {
+        std::cerr << "Found " << report.duplicateLines << " duplicate and " << report.missingLines
+                  << " missing line numbers" << std::endl;
+    }
+
+    std::cout << "Packed " << numFragments << " of " << files.size() << " data files into " << packFile << std::endl;
+    return 0;
+}
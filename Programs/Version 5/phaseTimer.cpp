@@ -0,0 +1,233 @@
+#include "phaseTimer.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <filesystem>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+PhaseRecord PhaseTrace::records[PhaseTrace::MAX_RECORDS];
+std::atomic<size_t> PhaseTrace::numRecords{0};
+std::string PhaseTrace::processName = "process";
+std::string PhaseTrace::traceDir;
+std::string PhaseTrace::traceFile;
+
+/**
+ * @brief Adds a record to the process's buffer.
+ *
+ * Records past the capacity of the buffer are dropped.
+ *
+ * @param name The name of the phase. Must outlive the process, e.g. a string literal.
+ * @param startNs When the phase started, from now().
+ * @param endNs When the phase ended, from now().
+ */
+void PhaseTrace::record(const char *name, uint64_t startNs, uint64_t endNs)
+{
+    // The thread ID is looked up once per thread rather than once per record
+    thread_local uint32_t threadId = static_cast<uint32_t>(syscall(SYS_gettid));
+
+    size_t idx = PhaseTrace::numRecords.fetch_add(1, std::memory_order_relaxed);
+    if (idx < MAX_RECORDS)
+    {
+        PhaseTrace::records[idx] = {name, startNs, endNs, threadId};
+    }
+}
+
+/**
+ * @brief Reads the monotonic clock.
+ *
+ * @return The current time in nanoseconds.
+ */
+uint64_t PhaseTrace::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Names the current process in the trace, e.g. "distributor 3".
+ *
+ * @param processName The name of the process.
+ */
+void PhaseTrace::setProcessName(const std::string &processName)
+{
+    PhaseTrace::processName = processName;
+}
+
+/**
+ * @brief Asks for a trace of this process and every process started after this call.
+ *
+ * Called by the server. A folder is created for the records of the child processes
+ * and its path is put in the environment, so the children find it through
+ * enableFromEnvironment after they are exec'd.
+ *
+ * @param traceFile The path of the Chrome trace-event JSON file to write.
+ * @return True if tracing was enabled, false if the folder couldn't be created.
+ */
+bool PhaseTrace::enable(const std::string &traceFile)
+{
+    char dirTemplate[] = "/tmp/prog05_trace_XXXXXX";
+    if (mkdtemp(dirTemplate) == nullptr)
+    {
+        perror("Creating the trace folder failed");
+        return false;
+    }
+
+    PhaseTrace::traceDir = dirTemplate;
+    PhaseTrace::traceFile = traceFile;
+    setenv(TRACE_DIR_VARIABLE, dirTemplate, 1);
+    return true;
+}
+
+/**
+ * @brief Writes the process's records when it exits if the server asked for a trace.
+ *
+ * Called by the distributors and processors at startup.
+ */
+void PhaseTrace::enableFromEnvironment()
+{
+    const char *dir = getenv(TRACE_DIR_VARIABLE);
+    if (dir == nullptr)
+    {
+        return;
+    }
+
+    PhaseTrace::traceDir = dir;
+    atexit(PhaseTrace::flush);
+}
+
+/**
+ * @brief Writes the process's records to its own file in the folder of records.
+ *
+ * The first line is the name of the process, then there is one tab-separated line per
+ * record: the name, the start, the end, and the thread.
+ */
+void PhaseTrace::flush()
+{
+    std::ofstream file(PhaseTrace::traceDir + "/" + std::to_string(getpid()) + ".trace");
+    file << PhaseTrace::processName << "\n";
+
+    size_t count = std::min(PhaseTrace::numRecords.load(), MAX_RECORDS);
+    for (size_t i = 0; i < count; i++)
+    {
+        const PhaseRecord &r = PhaseTrace::records[i];
+        file << r.name << "\t" << r.startNs << "\t" << r.endNs << "\t" << r.threadId << "\n";
+    }
+}
+
+/**
+ * @brief Merges the records of every process into the trace file.
+ *
+ * Called by the server once every child process has exited. The folder of records
+ * is removed afterwards.
+ *
+ * @return True if the trace was written, false if tracing isn't enabled or the file
+ *         couldn't be written.
+ */
+bool PhaseTrace::writeChromeTrace()
+{
+    if (PhaseTrace::traceFile.empty())
+    {
+        return false;
+    }
+
+    // The server's records go through the same folder as everyone else's
+    PhaseTrace::flush();
+
+    struct TraceEvent
+    {
+        std::string name;
+        uint64_t startNs;
+        uint64_t endNs;
+        long pid;
+        uint32_t threadId;
+    };
+
+    std::vector<TraceEvent> events;
+    std::vector<std::pair<long, std::string>> processNames;
+    for (const auto &entry : std::filesystem::directory_iterator(PhaseTrace::traceDir))
+    {
+        long pid = std::atol(entry.path().stem().c_str());
+        std::ifstream file(entry.path());
+
+        std::string name;
+        std::getline(file, name);
+        processNames.push_back({pid, name});
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            TraceEvent event;
+            event.pid = pid;
+            if (std::getline(fields, event.name, '\t') && fields >> event.startNs >> event.endNs >> event.threadId)
+            {
+                events.push_back(event);
+            }
+        }
+    }
+
+    std::filesystem::remove_all(PhaseTrace::traceDir);
+    unsetenv(TRACE_DIR_VARIABLE);
+
+    // Times are written in microseconds from the start of the earliest phase
+    uint64_t origin = UINT64_MAX;
+    for (const auto &event : events)
+    {
+        origin = std::min(origin, event.startNs);
+    }
+
+    std::ofstream trace(PhaseTrace::traceFile);
+    if (!trace)
+    {
+        std::cerr << "Error opening trace file: " << PhaseTrace::traceFile << std::endl;
+        return false;
+    }
+
+    trace << "{\"traceEvents\": [";
+    bool first = true;
+    for (const auto &process : processNames)
+    {
+        trace << (first ? "\n" : ",\n")
+              << "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << process.first
+              << ", \"args\": {\"name\": \"" << process.second << "\"}}";
+        first = false;
+    }
+
+    trace.setf(std::ios::fixed);
+    trace.precision(3);
+    for (const auto &event : events)
+    {
+        trace << (first ? "\n" : ",\n")
+              << "  {\"name\": \"" << event.name << "\", \"cat\": \"phase\", \"ph\": \"X\", \"ts\": "
+              << (event.startNs - origin) / 1000.0 << ", \"dur\": " << (event.endNs - event.startNs) / 1000.0
+              << ", \"pid\": " << event.pid << ", \"tid\": " << event.threadId << "}";
+        first = false;
+    }
+    trace << "\n]}\n";
+
+    return static_cast<bool>(trace);
+}
+
+/**
+ * @brief Starts timing a phase.
+ *
+ * @param name The name of the phase. Must outlive the process, e.g. a string literal.
+ */
+PhaseTimer::PhaseTimer(const char *name) : name(name), startNs(PhaseTrace::now())
+{
+}
+
+/**
+ * @brief Stops timing the phase and records it.
+ */
+PhaseTimer::~PhaseTimer()
+{
+    PhaseTrace::record(this->name, this->startNs, PhaseTrace::now());
+}
@@ -0,0 +1,145 @@
+#ifndef PHASE_TIMER_H
+#define PHASE_TIMER_H
+
+#include <string>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @struct PhaseRecord
+ * @brief When a phase of the pipeline started and ended in one thread of one process.
+ *
+ * The times are read from CLOCK_MONOTONIC, which every process on the machine shares,
+ * so the records of the server, the distributors and the processors line up.
+ */
+struct PhaseRecord
+{
+    const char *name;
+    uint64_t startNs;
+    uint64_t endNs;
+    uint32_t threadId;
+};
+
+/**
+ * @brief Collects the phase records of the current process and exports them as a trace.
+ *
+ * Recording is always on: a record is two clock reads and a store into a preallocated
+ * buffer, so the timers can stay in release builds. Nothing is written anywhere unless
+ * the server was asked for a trace. In that case the server creates a folder for the
+ * records and passes it down to the distributors and processors in the environment,
+ * each of them writes its records there when it exits, and the server merges every
+ * process's records into one Chrome trace-event JSON file (viewable in chrome://tracing
+ * or Perfetto).
+ */
+class PhaseTrace
+{
+public:
+    /**
+     * @brief Adds a record to the process's buffer.
+     *
+     * Records past the capacity of the buffer are dropped.
+     *
+     * @param name The name of the phase. Must outlive the process, e.g. a string literal.
+     * @param startNs When the phase started, from now().
+     * @param endNs When the phase ended, from now().
+     */
+    static void record(const char *name, uint64_t startNs, uint64_t endNs);
+
+    /**
+     * @brief Reads the monotonic clock.
+     *
+     * @return The current time in nanoseconds.
+     */
+    static uint64_t now();
+
+    /**
+     * @brief Names the current process in the trace, e.g. "distributor 3".
+     *
+     * @param processName The name of the process.
+     */
+    static void setProcessName(const std::string &processName);
+
+    /**
+     * @brief Asks for a trace of this process and every process started after this call.
+     *
+     * Called by the server. A folder is created for the records of the child processes
+     * and its path is put in the environment, so the children find it through
+     * enableFromEnvironment after they are exec'd.
+     *
+     * @param traceFile The path of the Chrome trace-event JSON file to write.
+     * @return True if tracing was enabled, false if the folder couldn't be created.
+     */
+    static bool enable(const std::string &traceFile);
+
+    /**
+     * @brief Writes the process's records when it exits if the server asked for a trace.
+     *
+     * Called by the distributors and processors at startup.
+     */
+    static void enableFromEnvironment();
+
+    /**
+     * @brief Merges the records of every process into the trace file.
+     *
+     * Called by the server once every child process has exited. The folder of records
+     * is removed afterwards.
+     *
+     * @return True if the trace was written, false if tracing isn't enabled or the file
+     *         couldn't be written.
+     */
+    static bool writeChromeTrace();
+
+private:
+    /**
+     * The most records a process keeps.
+     */
+    static constexpr size_t MAX_RECORDS = 4096;
+
+    /**
+     * The environment variable the folder of records is passed down in.
+     */
+    static constexpr const char *TRACE_DIR_VARIABLE = "PROG05_TRACE_DIR";
+
+    static PhaseRecord records[MAX_RECORDS];
+    static std::atomic<size_t> numRecords;
+    static std::string processName;
+    static std::string traceDir;
+    static std::string traceFile;
+
+    /**
+     * @brief Writes the process's records to its own file in the folder of records.
+     *
+     * The first line is the name of the process, then there is one tab-separated line per
+     * record: the name, the start, the end, and the thread.
+     */
+    static void flush();
+};
+
+/**
+ * @brief Records a phase from the moment it is constructed until it goes out of scope.
+ */
+class PhaseTimer
+{
+public:
+    /**
+     * @brief Starts timing a phase.
+     *
+     * @param name The name of the phase. Must outlive the process, e.g. a string literal.
+     */
+    explicit PhaseTimer(const char *name);
+
+    /**
+     * @brief Stops timing the phase and records it.
+     */
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+private:
+    const char *name;
+    uint64_t startNs;
+};
+
+#endif // PHASE_TIMER_H
@@ -5,36 +5,49 @@
 #include "testing.h"
 
 int main(int argc, char *argv[])
-{  
+{
+    if (argc != 7)
+    {
+        std::cerr << "Usage: " << argv[0] << " <writePipeFd> <clientIdx> <readLinesFd> <numLines> <readPipeFd> <outputFd>" << std::endl;
+        return 26;
+    }
+
     // Parent-to-child pipe (write end)
     int writePipeFd = std::stoi(argv[1]);
 
     // Get the client index
     int clientIdx = std::stoi(argv[2]);
 
-    // Get the number of files
-    int numFiles = std::stoi(argv[3]);
+    // Read end of the pipe the distributor sends the parsed lines over
+    int readLinesFd = std::stoi(argv[3]);
+
+    // Get the number of lines
+    size_t numLines = std::stoul(argv[4]);
+
+    // Read end of the server's pipe to the distributor, which the server sends the
+    // block's offset over
+    int readPipeFd = std::stoi(argv[5]);
 
-    // Get the list of files
-    std::vector<std::string> files = std::vector<std::string>(numFiles);
+    // The output file every processor writes its block into
+    int outputFd = std::stoi(argv[6]);
+
+    // Record this process's phases if the server asked for a trace
+    PhaseTrace::setProcessName("processor " + std::to_string(clientIdx));
+    PhaseTrace::enableFromEnvironment();
 
     // Create a client object
     Client client(clientIdx);
 
-    // Update the list of files
-    for (int i = 0; i < numFiles; i++)
-    {
-        files[i] = argv[i + 4];
-    }
-
-    client.setFiles(files); // Set the list of verified files once again
+    // Receive the lines the distributor already parsed instead of reading the files again
+    client.receiveLines(readLinesFd, numLines);
+    close(readLinesFd);
 
-    // Process the data files and reconstruct the block of code
-    client.processDataFiles(writePipeFd);
+    // Process the data files and write the block of code into its place in the output file
+    client.processDataFiles(writePipeFd, readPipeFd, outputFd);
 
-    // Since we're using the same pipe Fd that has been sent through the process chain
-    // we'll write to that, and the distribor parent process will handle signaling the
-    // server to process these results in the same way it signaled before.
+    // Since we're using the same pipe Fds that have been sent through the process chain
+    // we'll talk to the server over those, while the distributor parent process waits
+    // for this one to finish.
 
     DEBUG_FILE("(processor " + std::to_string(clientIdx) + ") Processed data files", "debug.log");
 
@@ -1,24 +1,29 @@
 #include "server.h"
 #include "testing.h"
+#include "communications.h"
 
 /**
  * @brief Constructs a new Server object.
  *
- * This constructor initializes a Server object and creates the specified number of
- * client objects.
+ * This constructor initializes a Server object without any clients. The number of
+ * clients is only known once the data files have been scanned, so the clients are
+ * created by getAllDataFiles.
  *
- * @param numClients The number of clients to be managed by the server.
+ * @param maxClients The most clients (distributor processes or engine tasks) the server
+ * will create, or 0 to use the number of cores. Each client owns a contiguous range of
+ * process indices, so there can be fewer clients than process indices.
  */
-Server::Server(int numClients)
+Server::Server(int maxClients)
 {
-    this->numClients = numClients;
-    std::vector<Client> clients;
-    for (int i = 0; i < numClients; i++)
+    if (maxClients <= 0)
     {
-        clients.push_back(Client(i));
+        maxClients = std::max<int>(std::thread::hardware_concurrency(), 1);
     }
-    this->clients = clients;
-    DEBUG_FILE("Server created with " + std::to_string(numClients) + " clients.", "debug.log");
+
+    this->numClients = 0;
+    this->maxClients = maxClients;
+    this->numBlocks = 0;
+    DEBUG_FILE("Server created with at most " + std::to_string(maxClients) + " clients.", "debug.log");
 }
 
 /**
@@ -32,6 +37,8 @@ Server::Server(int numClients)
  */
 void Server::distributeDataFiles(const std::vector<std::string> &files)
 {
+    PhaseTimer timer("distributeDataFiles");
+
     int numFiles = files.size();
     DEBUG_FILE("Retrieved " + std::to_string(numFiles) + " data files.", "debug.log");
 
@@ -49,7 +56,7 @@ void Server::distributeDataFiles(const std::vector<std::string> &files)
         this->clients[i].setFilesStartIdx(startIndex);
         this->clients[i].setFilesEndIdx(endIndex);
 
-        DEBUG_FILE("Client " + std::to_string(i) + " will process files " + std::to_string(startIndex) + " to " + std::to_string(endIndex - 1), "debug.log");
+        DEBUG_LOG(LogLevel::Debug, "Client " + std::to_string(i) + " will process files " + std::to_string(startIndex) + " to " + std::to_string(endIndex - 1), "debug.log");
         startIndex = endIndex;
     }
 
@@ -57,16 +64,21 @@ void Server::distributeDataFiles(const std::vector<std::string> &files)
 }
 
 /**
- * @brief Retrieves all regular files from the specified folder.
+ * @brief Retrieves all regular files from the specified folder and creates the clients.
  *
  * This function iterates through the directory specified by the folderPath
- * and collects the paths of all regular files into a vector of strings.
+ * and collects the paths of all regular files into a vector of strings. The first
+ * line of every file is then read on several threads to find the highest process
+ * index, which determines the number of blocks of code. The server creates one client
+ * per block, up to the maximum number of clients it was constructed with.
  *
  * @param folderPath The path to the folder from which to retrieve file paths.
  * @return std::vector<std::string> A vector containing the paths of all regular files in the specified folder.
  */
 std::vector<std::string> Server::getAllDataFiles(const std::string &folderPath)
 {
+    PhaseTimer timer("getAllDataFiles");
+
     std::vector<std::string> files;
 
     for (const auto &entry : std::filesystem::directory_iterator(folderPath))
@@ -76,9 +88,156 @@ std::vector<std::string> Server::getAllDataFiles(const std::string &folderPath)
             files.push_back(entry.path().string());
         }
     }
+
+    // The highest process index determines the number of blocks, with at least one
+    // block so an empty data folder still produces an (empty) output file
+    this->numBlocks = std::max(this->findHighestProcessIdx(files) + 1, 1);
+
+    // Each client owns one or more blocks, so there are never more clients than blocks
+    this->numClients = std::min(this->numBlocks, this->maxClients);
+
+    this->clients.clear();
+    for (int i = 0; i < this->numClients; i++)
+    {
+        this->clients.push_back(Client(i));
+    }
+
+    DEBUG_FILE("Server created " + std::to_string(this->numClients) + " clients for " + std::to_string(this->numBlocks) + " blocks.", "debug.log");
+
     return files;
 }
 
+/**
+ * @brief Maps a pack file made by the pack program and creates the clients.
+ *
+ * This is the alternative to getAllDataFiles for a data set packed into one file. The
+ * number of blocks comes from the pack's header, so no fragment has to be read to
+ * create the clients. The records of a pack are ordered by block, so each client is
+ * given the contiguous range of records of the blocks it owns as its range of files.
+ *
+ * @param packPath The path to the pack file.
+ */
+void Server::openDataPack(const std::string &packPath)
+{
+    PhaseTimer timer("openDataPack");
+
+    if (!this->pack.open(packPath))
+    {
+        DEBUG_ERROR("Failed to open data pack " + packPath, "debug.log");
+        exit(169);
+    }
+
+    // Same as a folder: at least one block, and never more clients than blocks
+    this->numBlocks = std::max(this->pack.getNumBlocks(), 1);
+    this->numClients = std::min(this->numBlocks, this->maxClients);
+
+    // A client without any records (in an empty pack) gets an empty range
+    this->clients.clear();
+    for (int i = 0; i < this->numClients; i++)
+    {
+        this->clients.push_back(Client(i));
+        this->clients[i].setFilesStartIdx(0);
+        this->clients[i].setFilesEndIdx(0);
+    }
+
+    // Each client owns a contiguous range of blocks, so its records are contiguous too:
+    // they start at its first block and end after its last one
+    int previousOwner = -1;
+    for (int block = 0; block < this->pack.getNumBlocks(); block++)
+    {
+        int ownerIdx = Client::getBlockOwner(block, this->numBlocks, this->numClients);
+        if (ownerIdx != previousOwner)
+        {
+            this->clients[ownerIdx].setFilesStartIdx(this->pack.getBlockStart(block));
+            previousOwner = ownerIdx;
+        }
+        this->clients[ownerIdx].setFilesEndIdx(this->pack.getBlockStart(block + 1));
+    }
+
+    DEBUG_FILE("Opened data pack of " + std::to_string(this->pack.size()) + " fragments, created " + std::to_string(this->numClients) + " clients for " + std::to_string(this->numBlocks) + " blocks.", "debug.log");
+}
+
+/**
+ * @brief Retrieves the number of clients managed by the server.
+ *
+ * @return The number of clients.
+ */
+int Server::getNumClients() const
+{
+    return this->numClients;
+}
+
+/**
+ * @brief Retrieves the number of blocks of code, one per process index.
+ *
+ * @return The number of blocks.
+ */
+int Server::getNumBlocks() const
+{
+    return this->numBlocks;
+}
+
+/**
+ * @brief Finds the highest process index among the data files.
+ *
+ * The files are split evenly between a number of threads, each reading the first
+ * line of its files in batches with its own FragmentReader and keeping track of the
+ * highest process index it has seen. Files that can't be read or parsed are ignored.
+ *
+ * @param files A vector of file paths to scan.
+ * @return The highest process index found, or -1 if no file could be parsed.
+ */
+int Server::findHighestProcessIdx(const std::vector<std::string> &files)
+{
+    PhaseTimer timer("findHighestProcessIdx");
+
+    DEBUG_FILE("Parsing data file headers with the " + std::string(getFragmentParserName()) + " parser.", "debug.log");
+
+    // Don't bother spinning up threads for only a handful of files each
+    const size_t minFilesPerThread = 64;
+    size_t numThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    numThreads = std::max<size_t>(std::min(numThreads, files.size() / minFilesPerThread), 1);
+
+    std::vector<int> highestPerThread(numThreads, -1);
+    std::vector<std::thread> threads;
+
+    size_t filesPerThread = files.size() / numThreads;
+    size_t remainder = files.size() % numThreads;
+    size_t startIndex = 0;
+
+    for (size_t t = 0; t < numThreads; t++)
+    {
+        size_t endIndex = startIndex + filesPerThread + (t < remainder ? 1 : 0);
+
+        threads.emplace_back([&files, &highestPerThread, t, startIndex, endIndex]()
+                             {
+            FragmentReader reader;
+            std::vector<FragmentView> fragments;
+            std::vector<bool> parsed;
+            for (size_t batchStart = startIndex; batchStart < endIndex; batchStart += FragmentReader::BATCH_SIZE)
+            {
+                size_t batchSize = std::min(FragmentReader::BATCH_SIZE, endIndex - batchStart);
+                reader.readBatch(&files[batchStart], batchSize, fragments, parsed);
+                for (size_t i = 0; i < batchSize; i++)
+                {
+                    if (parsed[i] && fragments[i].processIdx > highestPerThread[t])
+                    {
+                        highestPerThread[t] = fragments[i].processIdx;
+                    }
+                }
+            } });
+
+        startIndex = endIndex;
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    return *std::max_element(highestPerThread.begin(), highestPerThread.end());
+}
+
 /**
  * @brief Verifies the distribution of data files among clients and later launches
  * subprocesses for data distribution and processing.
@@ -89,15 +248,36 @@ std::vector<std::string> Server::getAllDataFiles(const std::string &folderPath)
  * that don't belong to the client to the correct client. The parent process waits for all child
  * processes to complete verification and then signals them to proceed wiith processing.
  *
+ * The processors write their blocks of code straight into the output file. The server
+ * only collects the size of every block, works out where each block starts, and sends
+ * each processor its offset, so the code itself never passes through the server.
+ *
  * @param files A vector of strings representing the data files to be verified.
+ * @param outputFile The path to the output file the blocks are written into.
  */
-std::string Server::initializeDistributor(const std::vector<std::string> &files)
+void Server::initializeDistributor(const std::vector<std::string> &files, const std::string &outputFile)
 {
+    PhaseTimer timer("initializeDistributor");
+
+    // Every processor writes its own region of the output file, so it is opened once
+    // here and inherited by the distributors and their processors
+    std::string finalOutputFile = Server::getOutputFilePath(outputFile);
+    int outputFd = open(finalOutputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outputFd == -1)
+    {
+        std::cerr << "Error opening output file: " << finalOutputFile << std::endl;
+        return;
+    }
+
     // Create pipes for each child
-    std::vector<int> childToParentPipes(numClients);
+    std::vector<ChildChannel> childToParentPipes(numClients);
     std::vector<int> parentToChildPipes(numClients);
     std::vector<pid_t> childPIDs(numClients);
 
+    // Write the file paths once into a shared manifest that every distributor can map,
+    // so the paths don't need to be copied into each distributor's arguments
+    int manifestFd = Manifest::create(files);
+
     // Fork a child process for each client that will call a function to verify the data files
     // and send any files that don't belong to the client to the correct client
     for (int i = 0; i < this->numClients; i++)
@@ -121,18 +301,23 @@ std::string Server::initializeDistributor(const std::vector<std::string> &files)
 
             // Pass the client's index, the write end of the child to parent pipe,
             // the read end of the parent to child pipe, and the list of files to the child process
-            this->runDistributorChildProcess(i, pipeChildToParent[1], pipeParentToChild[0], files);
+            this->runDistributorChildProcess(i, pipeChildToParent[1], pipeParentToChild[0], manifestFd, outputFd);
             exit(0); // Exit child process
         }
         else if (pid > 0)
         {
             // Parent process
             childPIDs[i] = pid;
-            childToParentPipes[i] = pipeChildToParent[0]; // Read end of child-to-parent pipe (for receiving signals)
+            childToParentPipes[i] = {pipeChildToParent[0], "", false, false}; // Read end of child-to-parent pipe (for receiving signals)
             parentToChildPipes[i] = pipeParentToChild[1]; // Write end of parent-to-child pipe (for sending signals)
 
             close(pipeChildToParent[1]); // Close write end in parent
             close(pipeParentToChild[0]); // Close read end in parent
+
+            // Keep the server's ends out of the distributors forked after this one, so that
+            // each pipe only reports end of file once its own distributor is done with it
+            fcntl(pipeChildToParent[0], F_SETFD, FD_CLOEXEC);
+            fcntl(pipeParentToChild[1], F_SETFD, FD_CLOEXEC);
         }
         else
         {
@@ -143,78 +328,491 @@ std::string Server::initializeDistributor(const std::vector<std::string> &files)
 
     DEBUG_FILE("Launched child processes to verify data files distribution.", "debug.log");
 
+    // Every distributor has its own copy of the manifest descriptor now
+    close(manifestFd);
+
     // Wait for all child processes to send verified data files through pipes
     // Create a vector to store any incorrectly distributed files for redistribution
-    std::vector<std::vector<std::string>> incorrectlyDistributedFiles = this->awaitDistributorProcesses(childToParentPipes);
+    std::vector<std::vector<uint32_t>> incorrectlyDistributedFiles = this->awaitDistributorProcesses(childToParentPipes);
 
     // Redistribute any incorrectly distributed files by sending them to the correct clients
     this->redistributeDataFiles(incorrectlyDistributedFiles, parentToChildPipes);
 
-    // Distributor process do some work, create their own children, process data, etc
-    // Wait for all child processes to finish processing the data files
+    // Distributor process do some work, create their own children, process data, etc.
+    // Each processor reports the size of its block, and once every size is known each
+    // block's offset is the total size of the blocks before it.
+    std::vector<size_t> blockSizes = this->collectBlockSizes(childToParentPipes);
+
+    std::vector<size_t> blockOffsets(this->numClients);
+    size_t totalSize = 0;
+    for (int i = 0; i < this->numClients; i++)
+    {
+        blockOffsets[i] = totalSize;
+        totalSize += blockSizes[i];
+    }
+
+    // Size the file up front so the blocks can be written in any order
+    if (ftruncate(outputFd, totalSize) == -1)
+    {
+        std::cerr << "Error resizing output file: " << finalOutputFile << std::endl;
+        exit(163);
+    }
+
+    this->sendBlockOffsets(blockOffsets, parentToChildPipes);
+    close(outputFd);
+
+    // Wait until every processor has written its block
+    this->awaitBlocksWritten(childToParentPipes);
+
+    // Every child has written its block, so reap them now
     for (int i = 0; i < this->numClients; i++)
     {
         int status;
         waitpid(childPIDs[i], &status, 0);
+        close(parentToChildPipes[i]);
+    }
+
+    DEBUG_FILE("Finished distributing and processing data files.", "debug.log");
+}
+
+/**
+ * @brief Verifies, redistributes, and processes the data files on a pool of threads.
+ *
+ * This is the in-process alternative to initializeDistributor. Instead of forking a
+ * distributor and a processor for every client, each stage of the pipeline is run for
+ * every client as a task on a pool with one thread per core, and the results of each
+ * stage are handed to the next one in memory:
+ * - Verification: each client reads its slice of the files and reports the ones that
+ *   belong to other clients.
+ * - Redistribution: each client reads the files that were reported as belonging to it.
+ * - Processing: each client sorts its lines and combines them into a block of code.
+ *
+ * Invariant: The data files have been distributed among the clients.
+ *
+ * @param files A vector of strings representing the data files to be verified.
+ * @return The blocks of code of every client, in client order.
+ */
+std::vector<std::string> Server::runThreadedEngine(const std::vector<std::string> &files)
+{
+    PhaseTimer timer("runThreadedEngine");
+
+    // The clients read the file paths through a manifest just like the distributor processes
+    int manifestFd = Manifest::create(files);
+    Manifest manifest(manifestFd);
+    close(manifestFd);
+
+    ThreadPool pool(std::thread::hardware_concurrency());
+    DEBUG_FILE("Running the threaded engine with " + std::to_string(pool.size()) + " threads.", "debug.log");
+
+    // Verification: every client sorts its own slice of the files
+    std::vector<std::vector<Client::MisplacedFile>> reports(this->numClients);
+    for (int i = 0; i < this->numClients; i++)
+    {
+        pool.submit([this, i, &reports, &manifest]()
+                    { reports[i] = this->clients[i].partitionDataFiles(this->numClients, this->numBlocks, manifest); });
     }
+    pool.wait();
+
+    // Group the misplaced files by the client they belong to
+    std::vector<std::vector<uint32_t>> incorrectlyDistributedFiles(this->numClients);
+    for (const auto &report : reports)
+    {
+        for (const auto &misplaced : report)
+        {
+            incorrectlyDistributedFiles[misplaced.targetIdx].push_back(misplaced.fileIdx);
+        }
+    }
+
+    DEBUG_FILE("Verified data files distribution for all clients.", "debug.log");
+
+    // Redistribution: every client reads the files that were found to belong to it
+    for (int i = 0; i < this->numClients; i++)
+    {
+        pool.submit([this, i, &incorrectlyDistributedFiles, &manifest]()
+                    {
+            PhaseTimer timer("redistributeDataFiles");
+            for (uint32_t fileIdx : incorrectlyDistributedFiles[i])
+            {
+                this->clients[i].addFile(std::string(manifest.getFile(fileIdx)));
+            } });
+    }
+    pool.wait();
+
+    // Processing: every client combines its lines into a block of code
+    std::vector<std::string> combinedResults(this->numClients);
+    for (int i = 0; i < this->numClients; i++)
+    {
+        pool.submit([this, i, &combinedResults]()
+                    { combinedResults[i] = this->clients[i].combineLines(); });
+    }
+    pool.wait();
 
     DEBUG_FILE("Finished distributing and processing data files.", "debug.log");
 
-    // Children have finsihed processing the data files since they've terminated.
-    // Now We can retrieve the code blocks sent by the children.
-    std::vector<std::string> combinedResults = this->collectProcessedDataResults(childToParentPipes);
+    // The blocks are written out in client order without being concatenated first
+    return combinedResults;
+}
 
-    // Concatenate the combined results from all clients
-    return std::accumulate(combinedResults.begin(), combinedResults.end(), std::string());
+/**
+ * @brief Routes every fragment straight to its owner while the data files are scanned.
+ *
+ * This is a variant of runThreadedEngine without the barrier between verification and
+ * processing. Each client's slice of the files is scanned as a task on the pool, and
+ * every fragment is pushed to the queue of the client that owns it as soon as it has
+ * been parsed. Whenever a queue has lines waiting, a task is scheduled to append them
+ * to the owner's FragmentTable, so the owners take in their lines while the scan is
+ * still running and nothing has to be read twice. Each owner orders its lines once at
+ * the end, which is linear when the line numbers are dense.
+ *
+ * Invariant: The data files have been distributed among the clients.
+ *
+ * @param files A vector of strings representing the data files to be processed.
+ * @return The blocks of code of every client, in client order.
+ */
+std::vector<std::string> Server::runStreamingEngine(const std::vector<std::string> &files)
+{
+    PhaseTimer timer("runStreamingEngine");
+
+    ThreadPool pool(std::thread::hardware_concurrency());
+    DEBUG_FILE("Running the streaming engine with " + std::to_string(pool.size()) + " threads.", "debug.log");
+
+    std::vector<OwnerQueue> queues(this->numClients);
+
+    // Scanning: every client's slice is read on its own task, and the fragments are
+    // collected into small batches per owner so a queue is locked once per batch
+    for (int i = 0; i < this->numClients; i++)
+    {
+        pool.submit([this, i, &files, &pool, &queues]()
+                    {
+            FragmentReader reader;
+            std::vector<FragmentView> fragments;
+            std::vector<bool> parsed;
+            std::vector<FragmentTable> batches(this->numClients);
+
+            int filesEndIdx = this->clients[i].getFilesEndIdx();
+            for (int batchStart = this->clients[i].getFilesStartIdx(); batchStart < filesEndIdx; batchStart += FragmentReader::BATCH_SIZE)
+            {
+                size_t batchSize = std::min<size_t>(FragmentReader::BATCH_SIZE, filesEndIdx - batchStart);
+                reader.readBatch(&files[batchStart], batchSize, fragments, parsed);
+
+                for (size_t j = 0; j < batchSize; j++)
+                {
+                    const FragmentView &fragment = fragments[j];
+                    if (!parsed[j] || fragment.processIdx < 0 || fragment.processIdx >= this->numBlocks)
+                    {
+                        DEBUG_WARNING("Skipping unreadable or invalid data file: " + files[batchStart + j], "debug.log");
+                        continue;
+                    }
+
+                    int ownerIdx = Client::getBlockOwner(fragment.processIdx, this->numBlocks, this->numClients);
+                    batches[ownerIdx].append(fragment.processIdx, fragment.lineNum, fragment.code);
+                    if (batches[ownerIdx].size() >= STREAM_BATCH_SIZE)
+                    {
+                        this->pushToOwner(pool, queues, ownerIdx, batches[ownerIdx]);
+                    }
+                }
+            }
+
+            // Push whatever is left once the slice has been scanned
+            for (int ownerIdx = 0; ownerIdx < this->numClients; ownerIdx++)
+            {
+                if (batches[ownerIdx].size() > 0)
+                {
+                    this->pushToOwner(pool, queues, ownerIdx, batches[ownerIdx]);
+                }
+            } });
+    }
+
+    // Merge tasks are submitted by the scanning tasks, so this also waits for those
+    pool.wait();
+
+    DEBUG_FILE("Finished routing data files to their owners.", "debug.log");
+
+    // Processing: every owner orders its lines and joins them into its block
+    std::vector<std::string> combinedResults(this->numClients);
+    for (int i = 0; i < this->numClients; i++)
+    {
+        pool.submit([this, i, &combinedResults]()
+                    { combinedResults[i] = this->clients[i].combineLines(); });
+    }
+    pool.wait();
+
+    DEBUG_FILE("Finished distributing and processing data files.", "debug.log");
+
+    // The blocks are written out in client order without being concatenated first
+    return combinedResults;
 }
 
 /**
- * @brief Runs the distributor child process for a specific client.
+ * @brief Rebuilds the program by placing every fragment at its global line number.
  *
- * This function prepares the arguments and executes the distributor program
- * for the specified client. It constructs the argument list based on the
- * client's file indices and the total number of clients.
+ * In the data sets the line numbers count through the whole program rather than
+ * restarting in every block, so the line number alone says where a fragment goes. The
+ * files are scanned in chunks on the pool, and each fragment is stored straight into
+ * slot lineNum - 1 of an array with one slot per data file. Reading the slots in order
+ * then gives the program without sorting, merging, or concatenating per-client blocks,
+ * and the clients' slices of the files don't matter.
  *
- * @param i The index of the client for which the distributor process is run.
- * @param writePipeFd The file descriptor for the write end of the pipe.
- * @param readPipeFd The file descriptor for the read end of the pipe.
- * @param files A vector of file paths to be distributed among clients.
+ * If a line number falls outside the array, two fragments share a line number, or the
+ * blocks don't come out in process index order, the numbering isn't global after all.
+ * Every fragment is then ordered by (processIdx, lineNum) with Client::orderLines
+ * instead, which gives the same output as the other engines.
+ *
+ * @param files A vector of strings representing the data files to be processed.
+ * @return The reconstructed program as a single block.
  */
-void Server::runDistributorChildProcess(int i, int writePipeFd, int readPipeFd, const std::vector<std::string> &files)
+std::vector<std::string> Server::runGlobalEngine(const std::vector<std::string> &files)
 {
-    int numFiles = this->clients[i].getFilesEndIdx() - this->clients[i].getFilesStartIdx();
+    PhaseTimer timer("runGlobalEngine");
+
+    ThreadPool pool(std::thread::hardware_concurrency());
+    DEBUG_FILE("Running the global engine with " + std::to_string(pool.size()) + " threads.", "debug.log");
+
+    // One slot per data file, claimed by the first fragment with that line number
+    size_t numSlots = files.size();
+    std::vector<Client::LineData> slots(numSlots);
+    std::unique_ptr<std::atomic<bool>[]> claimed(new std::atomic<bool>[numSlots]());
+
+    // Fragments that didn't get a slot of their own
+    std::mutex overflowMutex;
+    std::vector<Client::LineData> overflow;
+
+    for (size_t start = 0; start < files.size(); start += GLOBAL_CHUNK_SIZE)
+    {
+        size_t end = std::min(start + GLOBAL_CHUNK_SIZE, files.size());
+        pool.submit([this, start, end, numSlots, &files, &slots, &claimed, &overflowMutex, &overflow]()
+                    {
+            FragmentReader reader;
+            std::vector<FragmentView> fragments;
+            std::vector<bool> parsed;
+            reader.readBatch(&files[start], end - start, fragments, parsed);
+
+            for (size_t j = start; j < end; j++)
+            {
+                const FragmentView &fragment = fragments[j - start];
+                if (!parsed[j - start] || fragment.processIdx < 0 || fragment.processIdx >= this->numBlocks)
+                {
+                    DEBUG_WARNING("Skipping unreadable or invalid data file: " + files[j], "debug.log");
+                    continue;
+                }
+
+                Client::LineData line = {fragment.processIdx, fragment.lineNum, std::string(fragment.code)};
+                size_t slot = static_cast<size_t>(fragment.lineNum) - 1;
+                if (fragment.lineNum >= 1 && slot < numSlots && !claimed[slot].exchange(true))
+                {
+                    slots[slot] = std::move(line);
+                }
+                else
+                {
+                    std::lock_guard<std::mutex> lock(overflowMutex);
+                    overflow.push_back(std::move(line));
+                }
+            } });
+    }
+    pool.wait();
+
+    // Collect the claimed slots in line order, checking that the blocks come out in order
+    std::vector<Client::LineData> lines;
+    lines.reserve(numSlots + overflow.size());
+    bool inOrder = overflow.empty();
+    for (size_t slot = 0; slot < numSlots; slot++)
+    {
+        if (claimed[slot])
+        {
+            inOrder = inOrder && (lines.empty() || lines.back().processIdx <= slots[slot].processIdx);
+            lines.push_back(std::move(slots[slot]));
+        }
+    }
 
-    // Precompute the total number of arguments
-    unsigned int baseArgs = 7;
-    size_t totalArgs = baseArgs + numFiles + 1;
+    OrderReport report = {0, 0};
+    if (inOrder)
+    {
+        DEBUG_FILE("Placed every fragment by its global line number.", "debug.log");
 
-    // Create a vector of strings to store the arguments
+        // Every fragment has a slot of its own, so only the gaps inside a block are left to count
+        for (size_t i = 1; i < lines.size(); i++)
+        {
+            if (lines[i].processIdx == lines[i - 1].processIdx)
+            {
+                report.missingLines += lines[i].lineNum - lines[i - 1].lineNum - 1;
+            }
+        }
+    }
+    else
+    {
+        // The line numbers aren't global, so order the fragments by block like the other engines
+        DEBUG_FILE("Line numbers are not global, ordering " + std::to_string(overflow.size()) + " extra fragments by block.", "debug.log");
+        lines.insert(lines.end(), std::make_move_iterator(overflow.begin()), std::make_move_iterator(overflow.end()));
 
-    std::vector<std::string> args(totalArgs);
-    args[0] = std::string(EXECUTABLES_PATH + "distributor");
-    args[1] = std::to_string(writePipeFd);
-    args[2] = std::to_string(readPipeFd);
-    args[3] = std::to_string(this->numClients);
-    args[4] = std::to_string(i);
-    args[5] = std::to_string(this->clients[i].getFilesStartIdx());
-    args[6] = std::to_string(this->clients[i].getFilesEndIdx());
+        report = Client::orderLines(lines);
+    }
 
-    // Add the subset of files for the current client to the argument list
-    int argsStartIdx = baseArgs;
-    for (int j = this->clients[i].getFilesStartIdx(); j < this->clients[i].getFilesEndIdx(); ++j)
+    if (report.duplicateLines > 0 || report.missingLines > 0)
     {
-        args[argsStartIdx++] = files[j];
+        std::cerr << "Found " << report.duplicateLines << " duplicate and " << report.missingLines
+                  << " missing line numbers" << std::endl;
     }
 
+    DEBUG_FILE("Finished distributing and processing data files.", "debug.log");
+
+    return {Client::joinLines(lines)};
+}
+
+/**
+ * @brief Rebuilds the program from a pack file opened with openDataPack.
+ *
+ * The records in the pack are already ordered and their code is stored in output
+ * order, so there is nothing to verify, redistribute or sort. Each client's range of
+ * records is checked as a task on the pool, and its block of code is the slice of the
+ * mapped file its records cover. No data is copied and no system call is made per
+ * fragment.
+ *
+ * Invariant: A pack has been opened with openDataPack.
+ *
+ * @return The blocks of code of every client, in client order, as views into the pack.
+ */
+std::vector<std::string_view> Server::runPackEngine()
+{
+    PhaseTimer timer("runPackEngine");
+
+    ThreadPool pool(std::thread::hardware_concurrency());
+    DEBUG_FILE("Running the pack engine with " + std::to_string(pool.size()) + " threads.", "debug.log");
+
+    std::vector<std::string_view> blocks(this->numClients);
+    // One byte per client, since the tasks set their flags at the same time and
+    // std::vector<bool> packs them into shared words
+    std::vector<char> valid(this->numClients);
+    for (int i = 0; i < this->numClients; i++)
+    {
+        pool.submit([this, i, &blocks, &valid]()
+                    {
+            PhaseTimer timer("combineLines");
+            size_t startIdx = this->clients[i].getFilesStartIdx();
+            size_t endIdx = this->clients[i].getFilesEndIdx();
+
+            OrderReport report;
+            valid[i] = this->pack.checkRecords(startIdx, endIdx, report);
+            if (valid[i] && (report.duplicateLines > 0 || report.missingLines > 0))
+            {
+                std::cerr << "Client " << i << " found " << report.duplicateLines << " duplicate and "
+                          << report.missingLines << " missing line numbers" << std::endl;
+            }
+
+            blocks[i] = this->pack.getText(startIdx, endIdx); });
+    }
+    pool.wait();
+
+    for (int i = 0; i < this->numClients; i++)
+    {
+        if (!valid[i])
+        {
+            std::cerr << "The data pack's records for client " << i << " are corrupt" << std::endl;
+            DEBUG_ERROR("Corrupt records in the data pack for client " + std::to_string(i), "debug.log");
+            exit(184);
+        }
+    }
+
+    DEBUG_FILE("Finished processing the data pack.", "debug.log");
+
+    return blocks;
+}
+
+/**
+ * @brief Pushes a batch of lines to a client's queue, scheduling a merge if needed.
+ *
+ * @param pool The pool the merge task is submitted to.
+ * @param queues The queues of every client.
+ * @param ownerIdx The index of the client the lines belong to.
+ * @param batch The lines to push. The batch is left empty.
+ */
+void Server::pushToOwner(ThreadPool &pool, std::vector<OwnerQueue> &queues, int ownerIdx, FragmentTable &batch)
+{
+    OwnerQueue &queue = queues[ownerIdx];
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.pending.append(batch);
+        if (!queue.scheduled)
+        {
+            queue.scheduled = true;
+            schedule = true;
+        }
+    }
+
+    if (schedule)
+    {
+        pool.submit([this, &queues, ownerIdx]()
+                    { this->drainOwnerQueue(queues, ownerIdx); });
+    }
+}
+
+/**
+ * @brief Merges a client's waiting lines until its queue is empty.
+ *
+ * @param queues The queues of every client.
+ * @param ownerIdx The index of the client to merge lines into.
+ */
+void Server::drainOwnerQueue(std::vector<OwnerQueue> &queues, int ownerIdx)
+{
+    OwnerQueue &queue = queues[ownerIdx];
+    FragmentTable batch;
+
+    while (true)
+    {
+        {
+            // Take everything that arrived since the last merge, or give up the
+            // schedule if nothing did so the next push schedules a new task
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.pending.size() == 0)
+            {
+                queue.scheduled = false;
+                return;
+            }
+            std::swap(batch, queue.pending);
+        }
+
+        this->clients[ownerIdx].mergeLines(batch);
+    }
+}
+
+/**
+ * @brief Runs the distributor child process for a specific client.
+ *
+ * This function prepares the arguments and executes the distributor program
+ * for the specified client. It constructs the argument list based on the
+ * client's file indices, the total number of clients and the number of blocks. The file paths themselves
+ * are not passed as arguments; the distributor maps them from the shared manifest.
+ *
+ * @param i The index of the client for which the distributor process is run.
+ * @param writePipeFd The file descriptor for the write end of the pipe.
+ * @param readPipeFd The file descriptor for the read end of the pipe.
+ * @param manifestFd The file descriptor of the manifest holding all the file paths.
+ * @param outputFd The file descriptor of the output file the processor writes its block into.
+ */
+void Server::runDistributorChildProcess(int i, int writePipeFd, int readPipeFd, int manifestFd, int outputFd)
+{
+    // The arguments are the same size no matter how many files the client has
+    std::vector<std::string> args = {
+        std::string(EXECUTABLES_PATH + "distributor"),
+        std::to_string(writePipeFd),
+        std::to_string(readPipeFd),
+        std::to_string(this->numClients),
+        std::to_string(this->numBlocks),
+        std::to_string(i),
+        std::to_string(this->clients[i].getFilesStartIdx()),
+        std::to_string(this->clients[i].getFilesEndIdx()),
+        std::to_string(manifestFd),
+        std::to_string(outputFd)};
+
     // Convert the vector of strings to a vector of char* for execvp
-    std::vector<char *> c_args(totalArgs);
-    for (size_t i = 0; i < totalArgs; i++)
+    std::vector<char *> c_args(args.size() + 1);
+    for (size_t j = 0; j < args.size(); j++)
     {
-        c_args[i] = const_cast<char *>(args[i].c_str());
+        c_args[j] = const_cast<char *>(args[j].c_str());
     }
-    c_args[totalArgs - 1] = nullptr; // Null-terminate the argument list
+    c_args[args.size()] = nullptr; // Null-terminate the argument list
 
-    DEBUG_FILE("Launched a distributor process for client " + std::to_string(i), "debug.log");
+    DEBUG_LOG(LogLevel::Debug, "Launched a distributor process for client " + std::to_string(i), "debug.log");
 
     // Call the child process's own program to verify the distribution of data files
     execvp(std::string(EXECUTABLES_PATH + "distributor").c_str(), c_args.data());
@@ -225,84 +823,166 @@ void Server::runDistributorChildProcess(int i, int writePipeFd, int readPipeFd,
 }
 
 /**
- * @brief Waits for distributor processes to send messages through pipes and collects
- * incorrectly distributed files.
+ * @brief Drains the child-to-parent pipes in whichever order they become ready.
  *
- * This function listens to multiple child-to-parent pipes for messages from distributor
- * processes. Each message contains the incorrectly distributed file path and the client
- * index it belongs to. The function reads these messages, parses them, and
- * stores the file paths in a vector for each client. The function continues to read
- * from each pipe until a "DONE" signal is received or the pipe is closed, meaning that
- * distributor process has finished verifying the data files and is waiting for the server
- * to redistribute any incorrectly distributed files before continuing.
+ * This function polls every channel that hasn't finished the current phase, reads
+ * whatever is available from the ready pipes, and hands each complete frame (a size
+ * followed by that many bytes) to the callback. The callback returns true once the
+ * child has nothing more to send in this phase. A channel whose pipe is closed is
+ * also considered finished. Bytes past the last frame of a phase are kept in the
+ * channel's buffer for the next phase.
  *
- * @param childToParentPipes A vector of file descriptors for the child-to-parent pipes.
- * @return A vector of vectors containing the file paths of incorrectly distributed files
- * for each client.
+ * @param channels The channels of all the distributor processes.
+ * @param onFrame Called with the index of the child and the contents of each frame.
  */
-std::vector<std::vector<std::string>> Server::awaitDistributorProcesses(std::vector<int> &childToParentPipes)
+void Server::drainChildPipes(std::vector<ChildChannel> &channels, const std::function<bool(int, std::string &)> &onFrame)
 {
-    // Store any incorrectly distributed files for redistribution
-    std::vector<std::vector<std::string>> incorrectlyDistributedFiles(this->numClients);
-
-    // Iterate over all child-to-parent pipes
-    for (int i = 0; i < this->numClients; ++i)
+    // Hands any complete frames sitting in a channel's buffer to the callback
+    auto parseFrames = [&](int i)
     {
-        while (true)
+        ChildChannel &channel = channels[i];
+        size_t pos = 0;
+        while (!channel.finished && channel.buffer.size() - pos >= sizeof(size_t))
         {
-            // Read the size of the incoming message
-            size_t messageSize;
-            ssize_t bytesRead = read(childToParentPipes[i], &messageSize, sizeof(messageSize));
-
-            if (bytesRead == 0)
-            {
-                // End of the pipe; no more data to read
-                DEBUG_FILE("Pipe closed for client " + std::to_string(i), "debug.log");
-                break;
-            }
-            else if (bytesRead != sizeof(messageSize))
+            size_t frameSize;
+            std::memcpy(&frameSize, channel.buffer.data() + pos, sizeof(frameSize));
+            if (channel.buffer.size() - pos - sizeof(frameSize) < frameSize)
             {
-                // Handle partial read or error
-                DEBUG_FILE("Error reading message size from client " + std::to_string(i), "debug.log");
-                exit(160);
+                break; // The rest of the frame hasn't arrived yet
             }
 
-            // Check if the message is a "DONE" signal
-            if (messageSize == 0)
+            std::string frame = channel.buffer.substr(pos + sizeof(frameSize), frameSize);
+            pos += sizeof(frameSize) + frameSize;
+            channel.finished = onFrame(i, frame);
+        }
+        channel.buffer.erase(0, pos);
+
+        if (channel.closed)
+        {
+            channel.finished = true;
+        }
+    };
+
+    for (size_t i = 0; i < channels.size(); i++)
+    {
+        channels[i].finished = false;
+        parseFrames(i); // Frames left over from the previous phase
+    }
+
+    std::vector<struct pollfd> pollFds;
+    std::vector<int> pollIdx;
+    char chunk[65536];
+
+    while (true)
+    {
+        pollFds.clear();
+        pollIdx.clear();
+        for (size_t i = 0; i < channels.size(); i++)
+        {
+            if (!channels[i].finished)
             {
-                DEBUG_FILE("Received DONE signal from client " + std::to_string(i), "debug.log");
-                break; // Exit the loop for this client
+                pollFds.push_back({channels[i].fd, POLLIN, 0});
+                pollIdx.push_back(i);
             }
+        }
 
-            // Read the actual message content
-            std::vector<char> buffer(messageSize);
-            bytesRead = read(childToParentPipes[i], buffer.data(), messageSize);
+        if (pollFds.empty())
+        {
+            break;
+        }
 
-            if (bytesRead != static_cast<ssize_t>(messageSize))
+        if (poll(pollFds.data(), pollFds.size(), -1) == -1)
+        {
+            if (errno == EINTR)
             {
-                DEBUG_FILE("Error reading message content from client " + std::to_string(i), "debug.log");
-                exit(161);
+                continue;
             }
+            DEBUG_ERROR("Polling the child pipes failed", "debug.log");
+            exit(167);
+        }
 
-            // Parse the message (expected format: "processIdx filePath")
-            std::string message(buffer.begin(), buffer.end());
-            DEBUG_FILE("Received message: " + message, "debug.log");
-
-            // Add the file to the list of incorrectly distributed files based on client index
-            size_t spacePos = message.find(' ');
-            if (spacePos != std::string::npos)
+        for (size_t j = 0; j < pollFds.size(); j++)
+        {
+            if (pollFds[j].revents == 0)
             {
-                int processIdx = std::stoi(message.substr(0, spacePos));
-                std::string filePath = message.substr(spacePos + 1);
+                continue;
+            }
 
-                incorrectlyDistributedFiles[processIdx].push_back(filePath);
+            int i = pollIdx[j];
+            ssize_t bytesRead = read(channels[i].fd, chunk, sizeof(chunk));
+            if (bytesRead > 0)
+            {
+                channels[i].buffer.append(chunk, bytesRead);
+            }
+            else if (bytesRead == 0)
+            {
+                DEBUG_LOG(LogLevel::Debug, "Pipe closed for client " + std::to_string(i), "debug.log");
+                channels[i].closed = true;
             }
-            else
+            else if (errno != EINTR)
             {
-                DEBUG_FILE("Malformed message from client " + std::to_string(i) + ": " + message, "debug.log");
+                DEBUG_ERROR("Error reading from client " + std::to_string(i), "debug.log");
+                exit(160);
             }
+
+            parseFrames(i);
         }
     }
+}
+
+/**
+ * @brief Waits for distributor processes to send messages through pipes and collects
+ * incorrectly distributed files.
+ *
+ * This function listens to multiple child-to-parent pipes for the report of each
+ * distributor process, reading from whichever pipe is ready so a slow distributor doesn't
+ * hold up the others. Each report is a single frame holding a packed array of
+ * MisplacedFile entries: the index of an incorrectly distributed file in the list of
+ * files, and the client index it belongs to. The function parses the reports and stores
+ * the file indices in a vector for each client. Receiving a distributor's report (or the
+ * pipe being closed) means that distributor process has finished verifying the data files
+ * and is waiting for the server to redistribute any incorrectly distributed files before
+ * continuing.
+ *
+ * @param channels The channels of the child-to-parent pipes.
+ * @return A vector of vectors containing the indices of incorrectly distributed files
+ * for each client.
+ */
+std::vector<std::vector<uint32_t>> Server::awaitDistributorProcesses(std::vector<ChildChannel> &channels)
+{
+    PhaseTimer timer("awaitDistributorProcesses");
+
+    // Store any incorrectly distributed files for redistribution
+    std::vector<std::vector<uint32_t>> incorrectlyDistributedFiles(this->numClients);
+
+    this->drainChildPipes(channels, [&]([[maybe_unused]] int i, std::string &message)
+                          {
+        if (message.size() % sizeof(Client::MisplacedFile) != 0)
+        {
+            DEBUG_ERROR("Malformed report from client " + std::to_string(i), "debug.log");
+            exit(161);
+        }
+
+        size_t numMisplaced = message.size() / sizeof(Client::MisplacedFile);
+        DEBUG_LOG(LogLevel::Debug, "Received report of " + std::to_string(numMisplaced) + " files from client " + std::to_string(i), "debug.log");
+
+        // Add each file to the list of incorrectly distributed files based on client index
+        for (size_t j = 0; j < numMisplaced; j++)
+        {
+            Client::MisplacedFile misplaced;
+            std::memcpy(&misplaced, message.data() + j * sizeof(misplaced), sizeof(misplaced));
+
+            if (misplaced.targetIdx >= static_cast<uint32_t>(this->numClients))
+            {
+                DEBUG_ERROR("Invalid client index in report from client " + std::to_string(i), "debug.log");
+                exit(161);
+            }
+
+            incorrectlyDistributedFiles[misplaced.targetIdx].push_back(misplaced.fileIdx);
+        }
+
+        // A distributor only sends one report, so it's done verifying
+        return true; });
 
     DEBUG_FILE("Verified data files distribution for all clients.", "debug.log");
 
@@ -312,138 +992,219 @@ std::vector<std::vector<std::string>> Server::awaitDistributorProcesses(std::vec
 /**
  * @brief Redistributes incorrectly distributed data files to the appropriate clients.
  *
- * This function iterates over a list of incorrectly distributed files for each client
- * and sends the file paths to the respective clients through pipes. It also sends an
- * ending signal to indicate that the redistribution is complete so that the distributor
- * can immediately resume and process the data files.
+ * This function sends each client the list of incorrectly distributed files that
+ * belong to it through its pipe. Every distributor already has the list of all files
+ * from the shared manifest, so the files are sent as 32-bit indices into that list
+ * rather than as paths.
  *
  * Each inner vector in incorrectlyDistributedFiles corresponds to a specific client.
- * The function writes the size of each file path followed by the actual file path
- * to the respective client's pipe. An ending signal (size = 0) is sent after all
- * files for a client have been redistributed.
+ * The function writes a single frame to each client's pipe: the size of the index array
+ * in bytes followed by the indices. Every client receives a frame, even an empty one, so
+ * the frame also signals that redistribution is complete and the distributor can
+ * immediately resume and process the data files.
  *
- * @param incorrectlyDistributedFiles A vector of vectors containing file paths that need
- * to be redistributed for each client.
+ * @param incorrectlyDistributedFiles A vector of vectors containing the indices of files
+ * that need to be redistributed for each client.
  * @param parentToChildPipes A vector of pipe file descriptors used to communicate with
  * each client.
  */
-void Server::redistributeDataFiles(const std::vector<std::vector<std::string>> &incorrectlyDistributedFiles, std::vector<int> &parentToChildPipes)
+void Server::redistributeDataFiles(const std::vector<std::vector<uint32_t>> &incorrectlyDistributedFiles, std::vector<int> &parentToChildPipes)
 {
+    PhaseTimer timer("redistributeDataFiles");
+
+    std::string frame;
+
     // Iterate over all clients
     for (size_t i = 0; i < incorrectlyDistributedFiles.size(); ++i)
     {
-        // Skip if there are no incorrectly distributed files for this client
-        if (incorrectlyDistributedFiles[i].empty())
+        const std::vector<uint32_t> &fileIndices = incorrectlyDistributedFiles[i];
+        DEBUG_LOG(LogLevel::Debug, "Redistributing " + std::to_string(fileIndices.size()) + " files to client " + std::to_string(i), "debug.log");
+
+        // Build the size and the indices into one buffer so they go out in a single write
+        size_t messageSize = fileIndices.size() * sizeof(uint32_t);
+        frame.assign(reinterpret_cast<const char *>(&messageSize), sizeof(messageSize));
+        frame.append(reinterpret_cast<const char *>(fileIndices.data()), messageSize);
+
+        if (!writeFull(parentToChildPipes[i], frame.data(), frame.size()))
         {
-            continue;
+            DEBUG_ERROR("Failed to write file indices to pipe for client " + std::to_string(i), "debug.log");
+            exit(162);
         }
+    }
+}
 
-        // Iterate over files that need to be redistributed to client `i`
-        for (const auto &file : incorrectlyDistributedFiles[i])
-        {
-            std::string debugMessage = "Redistributing file " + file + " to client " + std::to_string(i);
-            DEBUG_FILE(debugMessage, "debug.log");
+/**
+ * @brief Collects the size of every block of code from the running processors.
+ *
+ * Each processor sends a single frame holding the size of its block once it has combined
+ * its lines. The sizes are read from the child-to-parent pipes in whichever order they
+ * become ready.
+ *
+ * @param channels The channels of the child-to-parent pipes.
+ * @return The size of each client's block in bytes.
+ */
+std::vector<size_t> Server::collectBlockSizes(std::vector<ChildChannel> &channels)
+{
+    PhaseTimer timer("collectBlockSizes");
 
-            // Write the file path size to the pipe
-            size_t messageSize = file.size();
-            if (write(parentToChildPipes[i], &messageSize, sizeof(messageSize)) == -1)
-            {
-                DEBUG_FILE("Failed to write file size to pipe for client " + std::to_string(i), "debug.log");
-                exit(162);
-            }
+    std::vector<size_t> blockSizes(this->numClients);
+    std::vector<bool> received(this->numClients, false);
 
-            // Write the actual file path to the pipe
-            if (write(parentToChildPipes[i], file.c_str(), messageSize) == -1)
-            {
-                DEBUG_FILE("Failed to write file path to pipe for client " + std::to_string(i), "debug.log");
-                exit(163);
-            }
+    this->drainChildPipes(channels, [&](int i, std::string &message)
+                          {
+        if (message.size() != sizeof(size_t))
+        {
+            DEBUG_ERROR("Malformed block size from client " + std::to_string(i), "debug.log");
+            exit(164);
         }
 
-        // Send an ending signal (size = 0) to indicate redistribution is complete
-        size_t endSignal = 0;
-        if (write(parentToChildPipes[i], &endSignal, sizeof(endSignal)) == -1)
+        std::memcpy(&blockSizes[i], message.data(), sizeof(size_t));
+        received[i] = true;
+        DEBUG_LOG(LogLevel::Debug, "Received block size " + std::to_string(blockSizes[i]) + " from client " + std::to_string(i), "debug.log");
+        return true; });
+
+    for (int i = 0; i < this->numClients; i++)
+    {
+        if (!received[i])
         {
-            DEBUG_FILE("Failed to send ending signal to client " + std::to_string(i), "debug.log");
-            exit(164);
+            DEBUG_ERROR("Failed to read block size from client " + std::to_string(i), "debug.log");
+            exit(165);
         }
     }
+
+    return blockSizes;
 }
 
 /**
- * @brief Collects the combined results from the completed child processes.
+ * @brief Sends every processor the offset of its block in the output file.
  *
- * This function reads the combined blocks of code sent over pipes from the distributor
- * child processes and stores them in a vector of strings. The results are read from the
- * child-to-parent pipes.
+ * The offset is sent as a frame holding a single size_t over the pipe to the client's
+ * distributor, which the processor inherited.
  *
- * @param childToParentPipes A vector of file descriptors for the read end of the pipes.
- * @return std::vector<std::string> A vector of strings containing the combined results from the child processes.
+ * @param blockOffsets The offset of each client's block in the output file.
+ * @param parentToChildPipes A vector of pipe file descriptors used to communicate with
+ * each client.
  */
-std::vector<std::string> Server::collectProcessedDataResults(std::vector<int> &childToParentPipes)
+void Server::sendBlockOffsets(const std::vector<size_t> &blockOffsets, std::vector<int> &parentToChildPipes)
 {
-    std::vector<std::string> combinedResults(this->numClients);
+    PhaseTimer timer("sendBlockOffsets");
 
     for (int i = 0; i < this->numClients; i++)
     {
-        if (childToParentPipes[i] != -1)
+        size_t frame[2] = {sizeof(size_t), blockOffsets[i]};
+        if (!writeFull(parentToChildPipes[i], frame, sizeof(frame)))
         {
-            // Read the size of the result
-            size_t resultSize;
-            ssize_t bytesRead = read(childToParentPipes[i], &resultSize, sizeof(resultSize));
-            if (bytesRead != sizeof(resultSize))
-            {
-                DEBUG_FILE("Failed to read result size from client " + std::to_string(i), "debug.log");
-                exit(165);
-            }
+            DEBUG_ERROR("Failed to write block offset to pipe for client " + std::to_string(i), "debug.log");
+            exit(166);
+        }
+    }
+}
 
-            // Read the actual result content, a block of code
-            std::string result(resultSize, '\0');
-            bytesRead = read(childToParentPipes[i], result.data(), resultSize);
-            if (bytesRead != static_cast<ssize_t>(resultSize))
-            {
-                DEBUG_FILE("Incomplete read from client " + std::to_string(i), "debug.log");
-                exit(166);
-            }
+/**
+ * @brief Waits for every processor to write its block into the output file.
+ *
+ * Each processor sends an empty frame once its block is in place. A processor that
+ * exits without sending it leaves a gap in the output file, so the server exits with
+ * an error instead.
+ *
+ * @param channels The channels of the child-to-parent pipes.
+ */
+void Server::awaitBlocksWritten(std::vector<ChildChannel> &channels)
+{
+    PhaseTimer timer("awaitBlocksWritten");
+
+    std::vector<bool> received(this->numClients, false);
 
-            // Store the block of code in the vector of combined results
-            combinedResults[i] = result;
-            DEBUG_FILE("Received combined result from client " + std::to_string(i) + ": " + result, "debug.log");
+    this->drainChildPipes(channels, [&](int i, std::string &)
+                          {
+        received[i] = true;
+        return true; });
 
-            // Close the pipe after reading the result
-            close(childToParentPipes[i]);
-            childToParentPipes[i] = -1;
+    for (int i = 0; i < this->numClients; i++)
+    {
+        if (!received[i])
+        {
+            DEBUG_ERROR("Client " + std::to_string(i) + " did not write its block", "debug.log");
+            exit(168);
         }
-    }
 
-    return combinedResults;
+        // Close the pipe once the block has been written
+        close(channels[i].fd);
+        channels[i].fd = -1;
+    }
 }
 
 /**
- * @brief Writes the given content to the specified output file.
+ * @brief Writes the given blocks of code to the specified output file, in order.
  *
- * This function attempts to open the specified output file and write the provided
- * content to it. If the file cannot be opened, an error message is printed to std::cerr.
+ * The blocks are handed to the kernel as a list of buffers with writev, so they are
+ * written without first being copied into one string. If the file cannot be opened,
+ * an error message is printed to std::cerr.
  *
  * @param outputFile The path to the output file where the content will be written.
- * @param content The content to be written to the output file.
+ * @param blocks The blocks of code to be written to the output file.
  */
-void Server::writeOutputFile(const std::string &outputFile, const std::string &content)
+void Server::writeOutputFile(const std::string &outputFile, const std::vector<std::string> &blocks)
 {
-    std::string finalOutputFile = outputFile;
-    if (finalOutputFile.substr(finalOutputFile.find_last_of(".") + 1) != "c")
+    std::vector<std::string_view> views(blocks.begin(), blocks.end());
+    this->writeOutputFile(outputFile, views);
+}
+
+/**
+ * @brief Writes the given blocks of code to the specified output file, in order.
+ *
+ * @param outputFile The path to the output file where the content will be written.
+ * @param blocks Views of the blocks of code to be written to the output file.
+ */
+void Server::writeOutputFile(const std::string &outputFile, const std::vector<std::string_view> &blocks)
+{
+    PhaseTimer timer("writeOutputFile");
+
+    std::string finalOutputFile = Server::getOutputFilePath(outputFile);
+
+    int fd = open(finalOutputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
     {
-        finalOutputFile += ".c";
+        std::cerr << "Error opening output file: " << finalOutputFile << std::endl;
+        return;
     }
 
-    std::ofstream file(finalOutputFile);
-    if (file.is_open())
+    std::vector<struct iovec> iov;
+    for (const auto &block : blocks)
     {
-        file << content;
-        file.close();
+        if (!block.empty())
+        {
+            iov.push_back({const_cast<char *>(block.data()), block.size()});
+        }
     }
-    else
+
+    // A single writev call takes at most IOV_MAX buffers
+    for (size_t i = 0; i < iov.size(); i += IOV_MAX)
     {
-        std::cerr << "Error opening output file: " << finalOutputFile << std::endl;
+        int iovcnt = std::min<size_t>(iov.size() - i, IOV_MAX);
+        if (!writeFull(fd, iov.data() + i, iovcnt))
+        {
+            std::cerr << "Error writing output file: " << finalOutputFile << std::endl;
+            break;
+        }
+    }
+
+    close(fd);
+}
+
+/**
+ * @brief Adds the ".c" extension to the output file's path if it doesn't have it.
+ *
+ * @param outputFile The path to the output file given on the command line.
+ * @return The path the output file is written to.
+ */
+std::string Server::getOutputFilePath(const std::string &outputFile)
+{
+    std::string finalOutputFile = outputFile;
+    if (finalOutputFile.substr(finalOutputFile.find_last_of(".") + 1) != "c")
+    {
+        finalOutputFile += ".c";
     }
+
+    return finalOutputFile;
 }
@@ -9,8 +9,24 @@
 #include <unistd.h>
 #include <sys/wait.h>
 #include <limits.h>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <poll.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <mutex>
+#include <atomic>
+#include <memory>
 
 #include "client.h"
+#include "fragmentReader.h"
+#include "fragmentParser.h"
+#include "fragmentPack.h"
+#include "manifest.h"
+#include "threadPool.h"
+#include "phaseTimer.h"
 
 class Server
 {
@@ -18,12 +34,15 @@ public:
     /**
      * @brief Constructs a new Server object.
      *
-     * This constructor initializes a Server object and creates the specified number of
-     * client objects.
+     * This constructor initializes a Server object without any clients. The number of
+     * clients is only known once the data files have been scanned, so the clients are
+     * created by getAllDataFiles.
      *
-     * @param numClients The number of clients to be managed by the server.
+     * @param maxClients The most clients (distributor processes or engine tasks) the server
+     * will create, or 0 to use the number of cores. Each client owns a contiguous range of
+     * process indices, so there can be fewer clients than process indices.
      */
-    Server(int numClients);
+    Server(int maxClients);
 
     /**
      * @brief Distributes a list of data files evenly among the clients.
@@ -37,16 +56,45 @@ public:
     void distributeDataFiles(const std::vector<std::string> &files);
 
     /**
-     * @brief Retrieves all regular files from the specified folder.
+     * @brief Retrieves all regular files from the specified folder and creates the clients.
      *
      * This function iterates through the directory specified by the folderPath
-     * and collects the paths of all regular files into a vector of strings.
+     * and collects the paths of all regular files into a vector of strings. The first
+     * line of every file is then read on several threads to find the highest process
+     * index, which determines the number of blocks of code. The server creates one client
+     * per block, up to the maximum number of clients it was constructed with.
      *
      * @param folderPath The path to the folder from which to retrieve file paths.
      * @return std::vector<std::string> A vector containing the paths of all regular files in the specified folder.
      */
     std::vector<std::string> getAllDataFiles(const std::string &folderPath);
 
+    /**
+     * @brief Maps a pack file made by the pack program and creates the clients.
+     *
+     * This is the alternative to getAllDataFiles for a data set packed into one file. The
+     * number of blocks comes from the pack's header, so no fragment has to be read to
+     * create the clients. The records of a pack are ordered by block, so each client is
+     * given the contiguous range of records of the blocks it owns as its range of files.
+     *
+     * @param packPath The path to the pack file.
+     */
+    void openDataPack(const std::string &packPath);
+
+    /**
+     * @brief Retrieves the number of clients managed by the server.
+     *
+     * @return The number of clients.
+     */
+    int getNumClients() const;
+
+    /**
+     * @brief Retrieves the number of blocks of code, one per process index.
+     *
+     * @return The number of blocks.
+     */
+    int getNumBlocks() const;
+
     /**
      * @brief Verifies the distribution of data files among clients and later launches
      * subprocesses for data distribution and processing.
@@ -57,88 +105,303 @@ public:
      * that don't belong to the client to the correct client. The parent process waits for all child
      * processes to complete verification and then signals them to proceed wiith processing.
      *
+     * The processors write their blocks of code straight into the output file. The server
+     * only collects the size of every block, works out where each block starts, and sends
+     * each processor its offset, so the code itself never passes through the server.
+     *
+     * @param files A vector of strings representing the data files to be verified.
+     * @param outputFile The path to the output file the blocks are written into.
+     */
+    void initializeDistributor(const std::vector<std::string> &files, const std::string &outputFile);
+
+    /**
+     * @brief Verifies, redistributes, and processes the data files on a pool of threads.
+     *
+     * This is the in-process alternative to initializeDistributor. Instead of forking a
+     * distributor and a processor for every client, each stage of the pipeline is run for
+     * every client as a task on a pool with one thread per core, and the results of each
+     * stage are handed to the next one in memory:
+     * - Verification: each client reads its slice of the files and reports the ones that
+     *   belong to other clients.
+     * - Redistribution: each client reads the files that were reported as belonging to it.
+     * - Processing: each client sorts its lines and combines them into a block of code.
+     *
+     * Invariant: The data files have been distributed among the clients.
+     *
      * @param files A vector of strings representing the data files to be verified.
+     * @return The blocks of code of every client, in client order.
+     */
+    std::vector<std::string> runThreadedEngine(const std::vector<std::string> &files);
+
+    /**
+     * @brief Routes every fragment straight to its owner while the data files are scanned.
+     *
+     * This is a variant of runThreadedEngine without the barrier between verification and
+     * processing. Each client's slice of the files is scanned as a task on the pool, and
+     * every fragment is pushed to the queue of the client that owns it as soon as it has
+     * been parsed. Whenever a queue has lines waiting, a task is scheduled to append them
+     * to the owner's FragmentTable, so the owners take in their lines while the scan is
+     * still running and nothing has to be read twice. Each owner orders its lines once at
+     * the end, which is linear when the line numbers are dense.
+     *
+     * Invariant: The data files have been distributed among the clients.
+     *
+     * @param files A vector of strings representing the data files to be processed.
+     * @return The blocks of code of every client, in client order.
+     */
+    std::vector<std::string> runStreamingEngine(const std::vector<std::string> &files);
+
+    /**
+     * @brief Rebuilds the program by placing every fragment at its global line number.
+     *
+     * In the data sets the line numbers count through the whole program rather than
+     * restarting in every block, so the line number alone says where a fragment goes. The
+     * files are scanned in chunks on the pool, and each fragment is stored straight into
+     * slot lineNum - 1 of an array with one slot per data file. Reading the slots in order
+     * then gives the program without sorting, merging, or concatenating per-client blocks,
+     * and the clients' slices of the files don't matter.
+     *
+     * If a line number falls outside the array, two fragments share a line number, or the
+     * blocks don't come out in process index order, the numbering isn't global after all.
+     * Every fragment is then ordered by (processIdx, lineNum) with Client::orderLines
+     * instead, which gives the same output as the other engines.
+     *
+     * @param files A vector of strings representing the data files to be processed.
+     * @return The reconstructed program as a single block.
+     */
+    std::vector<std::string> runGlobalEngine(const std::vector<std::string> &files);
+
+    /**
+     * @brief Rebuilds the program from a pack file opened with openDataPack.
+     *
+     * The records in the pack are already ordered and their code is stored in output
+     * order, so there is nothing to verify, redistribute or sort. Each client's range of
+     * records is checked as a task on the pool, and its block of code is the slice of the
+     * mapped file its records cover. No data is copied and no system call is made per
+     * fragment.
+     *
+     * Invariant: A pack has been opened with openDataPack.
+     *
+     * @return The blocks of code of every client, in client order, as views into the pack.
      */
-    std::string initializeDistributor(const std::vector<std::string> &files);
+    std::vector<std::string_view> runPackEngine();
 
     /**
-     * @brief Writes the given content to the specified output file.
+     * @brief Writes the given blocks of code to the specified output file, in order.
      *
-     * This function attempts to open the specified output file and write the provided
-     * content to it. If the file cannot be opened, an error message is printed to std::cerr.
+     * The blocks are handed to the kernel as a list of buffers with writev, so they are
+     * written without first being copied into one string. If the file cannot be opened,
+     * an error message is printed to std::cerr.
+     *
+     * @param outputFile The path to the output file where the content will be written.
+     * @param blocks The blocks of code to be written to the output file.
+     */
+    void writeOutputFile(const std::string &outputFile, const std::vector<std::string> &blocks);
+
+    /**
+     * @brief Writes the given blocks of code to the specified output file, in order.
      *
      * @param outputFile The path to the output file where the content will be written.
-     * @param content The content to be written to the output file.
+     * @param blocks Views of the blocks of code to be written to the output file.
      */
-    void writeOutputFile(const std::string &outputFile, const std::string &content);
+    void writeOutputFile(const std::string &outputFile, const std::vector<std::string_view> &blocks);
 
 private:
     std::vector<Client> clients;
     int numClients;
+    int maxClients;
+    int numBlocks;
+
+    /**
+     * The data set when it was given as a pack file rather than a folder.
+     */
+    FragmentPack pack;
+
+    /**
+     * The number of fragments a scanning task collects for one owner before pushing
+     * them to the owner's queue.
+     */
+    static constexpr size_t STREAM_BATCH_SIZE = 64;
+
+    /**
+     * The number of data files each task of the global engine scans.
+     */
+    static constexpr size_t GLOBAL_CHUNK_SIZE = 256;
+
+    /**
+     * @struct OwnerQueue
+     * @brief The lines waiting to be merged into one client in the streaming engine.
+     *
+     * At most one merge task per client is scheduled at a time, so the client itself is
+     * only ever touched by one thread.
+     */
+    struct OwnerQueue
+    {
+        std::mutex mutex;
+        FragmentTable pending;
+        bool scheduled = false;
+    };
+
+    /**
+     * @brief Pushes a batch of lines to a client's queue, scheduling a merge if needed.
+     *
+     * @param pool The pool the merge task is submitted to.
+     * @param queues The queues of every client.
+     * @param ownerIdx The index of the client the lines belong to.
+     * @param batch The lines to push. The batch is left empty.
+     */
+    void pushToOwner(ThreadPool &pool, std::vector<OwnerQueue> &queues, int ownerIdx, FragmentTable &batch);
+
+    /**
+     * @brief Merges a client's waiting lines until its queue is empty.
+     *
+     * @param queues The queues of every client.
+     * @param ownerIdx The index of the client to merge lines into.
+     */
+    void drainOwnerQueue(std::vector<OwnerQueue> &queues, int ownerIdx);
+
+    /**
+     * @struct ChildChannel
+     * @brief Tracks the state of the pipe from one distributor process to the server.
+     *
+     * Bytes are read from the pipe whenever it is ready and buffered until a full
+     * length-prefixed frame has arrived, so frames can be parsed incrementally while
+     * the other pipes are being drained.
+     */
+    struct ChildChannel
+    {
+        int fd;
+        std::string buffer;
+        bool finished; // The current phase is over for this child
+        bool closed;   // The child closed its end of the pipe
+    };
+
+    /**
+     * @brief Drains the child-to-parent pipes in whichever order they become ready.
+     *
+     * This function polls every channel that hasn't finished the current phase, reads
+     * whatever is available from the ready pipes, and hands each complete frame (a size
+     * followed by that many bytes) to the callback. The callback returns true once the
+     * child has nothing more to send in this phase. A channel whose pipe is closed is
+     * also considered finished. Bytes past the last frame of a phase are kept in the
+     * channel's buffer for the next phase.
+     *
+     * @param channels The channels of all the distributor processes.
+     * @param onFrame Called with the index of the child and the contents of each frame.
+     */
+    void drainChildPipes(std::vector<ChildChannel> &channels, const std::function<bool(int, std::string &)> &onFrame);
+
+    /**
+     * @brief Finds the highest process index among the data files.
+     *
+     * The files are split evenly between a number of threads, each reading the first
+     * line of its files in batches with its own FragmentReader and keeping track of the
+     * highest process index it has seen. Files that can't be read or parsed are ignored.
+     *
+     * @param files A vector of file paths to scan.
+     * @return The highest process index found, or -1 if no file could be parsed.
+     */
+    int findHighestProcessIdx(const std::vector<std::string> &files);
 
     /**
      * @brief Runs the distributor child process for a specific client.
      *
      * This function prepares the arguments and executes the distributor program
      * for the specified client. It constructs the argument list based on the
-     * client's file indices and the total number of clients.
+     * client's file indices, the total number of clients and the number of blocks. The file paths themselves
+     * are not passed as arguments; the distributor maps them from the shared manifest.
      *
      * @param i The index of the client for which the distributor process is run.
      * @param writePipeFd The file descriptor for the write end of the pipe.
      * @param readPipeFd The file descriptor for the read end of the pipe.
-     * @param files A vector of file paths to be distributed among clients.
+     * @param manifestFd The file descriptor of the manifest holding all the file paths.
+     * @param outputFd The file descriptor of the output file the processor writes its block into.
      */
-    void runDistributorChildProcess(int i, int writePipeFd, int readPipeFd, const std::vector<std::string> &files);
+    void runDistributorChildProcess(int i, int writePipeFd, int readPipeFd, int manifestFd, int outputFd);
 
     /**
      * @brief Waits for distributor processes to send messages through pipes and collects
      * incorrectly distributed files.
      *
-     * This function listens to multiple child-to-parent pipes for messages from distributor
-     * processes. Each message contains the incorrectly distributed file path and the client
-     * index it belongs to. The function reads these messages, parses them, and
-     * stores the file paths in a vector for each client. The function continues to read
-     * from each pipe until a "DONE" signal is received or the pipe is closed, meaning that
-     * distributor process has finished verifying the data files and is waiting for the server
-     * to redistribute any incorrectly distributed files before continuing.
+     * This function listens to multiple child-to-parent pipes for the report of each
+     * distributor process, reading from whichever pipe is ready so a slow distributor doesn't
+     * hold up the others. Each report is a single frame holding a packed array of
+     * MisplacedFile entries: the index of an incorrectly distributed file in the list of
+     * files, and the client index it belongs to. The function parses the reports and stores
+     * the file indices in a vector for each client. Receiving a distributor's report (or the
+     * pipe being closed) means that distributor process has finished verifying the data files
+     * and is waiting for the server to redistribute any incorrectly distributed files before
+     * continuing.
      *
-     * @param childToParentPipes A vector of file descriptors for the child-to-parent pipes.
-     * @return A vector of vectors containing the file paths of incorrectly distributed files
+     * @param channels The channels of the child-to-parent pipes.
+     * @return A vector of vectors containing the indices of incorrectly distributed files
      * for each client.
      */
-    std::vector<std::vector<std::string>> awaitDistributorProcesses(std::vector<int> &childToParentPipes);
+    std::vector<std::vector<uint32_t>> awaitDistributorProcesses(std::vector<ChildChannel> &channels);
 
     /**
      * @brief Redistributes incorrectly distributed data files to the appropriate clients.
      *
-     * This function iterates over a list of incorrectly distributed files for each client
-     * and sends the file paths to the respective clients through pipes. It also sends an
-     * ending signal to indicate that the redistribution is complete so that the distributor
-     * can immediately resume and process the data files.
+     * This function sends each client the list of incorrectly distributed files that
+     * belong to it through its pipe. Every distributor already has the list of all files
+     * from the shared manifest, so the files are sent as 32-bit indices into that list
+     * rather than as paths.
      *
      * Each inner vector in incorrectlyDistributedFiles corresponds to a specific client.
-     * The function writes the size of each file path followed by the actual file path
-     * to the respective client's pipe. An ending signal (size = 0) is sent after all
-     * files for a client have been redistributed.
+     * The function writes a single frame to each client's pipe: the size of the index array
+     * in bytes followed by the indices. Every client receives a frame, even an empty one, so
+     * the frame also signals that redistribution is complete and the distributor can
+     * immediately resume and process the data files.
      *
-     * @param incorrectlyDistributedFiles A vector of vectors containing file paths that need
-     * to be redistributed for each client.
+     * @param incorrectlyDistributedFiles A vector of vectors containing the indices of files
+     * that need to be redistributed for each client.
      * @param parentToChildPipes A vector of pipe file descriptors used to communicate with
      * each client.
      */
-    void redistributeDataFiles(const std::vector<std::vector<std::string>> &incorrectlyDistributedFiles, std::vector<int> &parentToChildPipes);
+    void redistributeDataFiles(const std::vector<std::vector<uint32_t>> &incorrectlyDistributedFiles, std::vector<int> &parentToChildPipes);
+
+    /**
+     * @brief Collects the size of every block of code from the running processors.
+     *
+     * Each processor sends a single frame holding the size of its block once it has combined
+     * its lines. The sizes are read from the child-to-parent pipes in whichever order they
+     * become ready.
+     *
+     * @param channels The channels of the child-to-parent pipes.
+     * @return The size of each client's block in bytes.
+     */
+    std::vector<size_t> collectBlockSizes(std::vector<ChildChannel> &channels);
 
     /**
-     * @brief Collects the combined results from the completed child processes.
+     * @brief Sends every processor the offset of its block in the output file.
      *
-     * This function reads the combined blocks of code sent over pipes from the distributor
-     * child processes and stores them in a vector of strings. The results are read from the
-     * child-to-parent pipes.
+     * The offset is sent as a frame holding a single size_t over the pipe to the client's
+     * distributor, which the processor inherited.
+     *
+     * @param blockOffsets The offset of each client's block in the output file.
+     * @param parentToChildPipes A vector of pipe file descriptors used to communicate with
+     * each client.
+     */
+    void sendBlockOffsets(const std::vector<size_t> &blockOffsets, std::vector<int> &parentToChildPipes);
+
+    /**
+     * @brief Waits for every processor to write its block into the output file.
+     *
+     * Each processor sends an empty frame once its block is in place. A processor that
+     * exits without sending it leaves a gap in the output file, so the server exits with
+     * an error instead.
+     *
+     * @param channels The channels of the child-to-parent pipes.
+     */
+    void awaitBlocksWritten(std::vector<ChildChannel> &channels);
+
+    /**
+     * @brief Adds the ".c" extension to the output file's path if it doesn't have it.
      *
-     * @param childToParentPipes A vector of file descriptors for the read end of the pipes.
-     * @return std::vector<std::string> A vector of strings containing the combined results from the child processes.
+     * @param outputFile The path to the output file given on the command line.
+     * @return The path the output file is written to.
      */
-    std::vector<std::string> collectProcessedDataResults(std::vector<int> &childToParentPipes);
+    static std::string getOutputFilePath(const std::string &outputFile);
 };
 
 #endif // SERVER_H
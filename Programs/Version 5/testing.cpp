@@ -1 +1,146 @@
 #include "testing.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+namespace
+{
+    /**
+     * @struct LogFile
+     * @brief A log file opened by this process and the lines waiting to be written to it.
+     */
+    struct LogFile
+    {
+        int fd = -1;
+        std::string buffer;
+    };
+
+    std::mutex logMutex;
+    std::unordered_map<std::string, LogFile> logFiles;
+
+    // A forked child is about to be exec'd, which throws away its buffers without running
+    // the exit handlers, so it writes every line out right away
+    bool writeThrough = false;
+}
+
+const LogLevel DebugLog::threshold = DebugLog::initialize();
+
+/**
+ * @brief Checks whether messages of a level are kept.
+ *
+ * @param level The level of the message.
+ * @return True if the message should be logged, false otherwise.
+ */
+bool DebugLog::isEnabled(LogLevel level)
+{
+    return level <= DebugLog::threshold;
+}
+
+/**
+ * @brief Adds a line to the buffer of a log file.
+ *
+ * @param filePath The name of the log file in the Debug folder.
+ * @param line The line to log, including its newline.
+ * @param level The level of the message. Errors are written out right away.
+ */
+void DebugLog::write(const std::string &filePath, const std::string &line, LogLevel level)
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+
+    LogFile &logFile = logFiles[filePath];
+    if (logFile.fd == -1)
+    {
+        // The distributors and processors open their own descriptors after they are exec'd
+        std::string debugFilePath = std::string("./Debug/") + filePath;
+        logFile.fd = open(debugFilePath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (logFile.fd == -1)
+        {
+            perror(("Opening log file " + debugFilePath + " failed").c_str());
+            logFiles.erase(filePath);
+            return;
+        }
+    }
+
+    logFile.buffer += line;
+    if (writeThrough || logFile.buffer.size() >= FLUSH_THRESHOLD || level == LogLevel::Error)
+    {
+        DebugLog::flushLocked();
+    }
+}
+
+/**
+ * @brief Writes the buffers of every log file to their files.
+ */
+void DebugLog::flush()
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    DebugLog::flushLocked();
+}
+
+/**
+ * @brief Reads the level from the environment and registers the exit and fork handlers.
+ *
+ * @return The least important level that is kept.
+ */
+LogLevel DebugLog::initialize()
+{
+    // Whatever is still buffered is written when the process exits, including through exit(code)
+    atexit(DebugLog::flush);
+
+    // The buffers are emptied before a fork so the child doesn't write the parent's lines again,
+    // and the lock is held across it so the child doesn't inherit it locked by another thread
+    pthread_atfork([]
+                   { logMutex.lock(); DebugLog::flushLocked(); },
+                   []
+                   { logMutex.unlock(); },
+                   []
+                   { writeThrough = true; logMutex.unlock(); });
+
+    const char *level = getenv(LOG_LEVEL_VARIABLE);
+    std::string name = level == nullptr ? "debug" : level;
+    if (name == "error")
+    {
+        return LogLevel::Error;
+    }
+    else if (name == "warning")
+    {
+        return LogLevel::Warning;
+    }
+    else if (name == "info")
+    {
+        return LogLevel::Info;
+    }
+
+    return LogLevel::Debug;
+}
+
+/**
+ * @brief Writes the buffers of every log file. The caller holds the lock.
+ */
+void DebugLog::flushLocked()
+{
+    for (auto &[filePath, logFile] : logFiles)
+    {
+        // Each chunk holds whole lines, so lines from other processes only land between them
+        size_t written = 0;
+        while (written < logFile.buffer.size())
+        {
+            ssize_t result = ::write(logFile.fd, logFile.buffer.data() + written, logFile.buffer.size() - written);
+            if (result == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            if (result <= 0)
+            {
+                break;
+            }
+            written += result;
+        }
+        logFile.buffer.clear();
+    }
+}
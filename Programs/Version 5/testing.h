@@ -35,6 +35,86 @@ std::string toString(const std::vector<T> &vec)
     return oss.str();
 }
 
+/**
+ * @brief How important a debug message is. Lower values are more important.
+ */
+enum class LogLevel
+{
+    Error,
+    Warning,
+    Info,
+    Debug
+};
+
+/**
+ * @brief Buffers debug messages in memory and writes them to their log files in large chunks.
+ *
+ * Every log file is opened once per process and kept open. Messages are appended to the
+ * file's buffer and written out with a single write() once the buffer is full, when an
+ * error is logged, before the process forks and when it exits. A forked child writes
+ * every line right away, since exec'ing it would lose its buffers. The files are opened in
+ * append mode, so the whole lines written by the server, the distributors and the
+ * processors never overwrite each other.
+ *
+ * Messages less important than the level in the PROG05_LOG_LEVEL environment variable
+ * (error, warning, info or debug) are dropped before they are formatted. Every message
+ * is kept by default.
+ */
+class DebugLog
+{
+public:
+    /**
+     * @brief Checks whether messages of a level are kept.
+     *
+     * @param level The level of the message.
+     * @return True if the message should be logged, false otherwise.
+     */
+    static bool isEnabled(LogLevel level);
+
+    /**
+     * @brief Adds a line to the buffer of a log file.
+     *
+     * @param filePath The name of the log file in the Debug folder.
+     * @param line The line to log, including its newline.
+     * @param level The level of the message. Errors are written out right away.
+     */
+    static void write(const std::string &filePath, const std::string &line, LogLevel level);
+
+    /**
+     * @brief Writes the buffers of every log file to their files.
+     */
+    static void flush();
+
+private:
+    /**
+     * The least important level that is kept. It is read when the program starts, which
+     * also registers the exit and fork handlers before any thread or child exists.
+     */
+    static const LogLevel threshold;
+
+    /**
+     * A buffer is written out once it holds this many bytes.
+     */
+    static constexpr size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    /**
+     * The environment variable the level is read from.
+     */
+    static constexpr const char *LOG_LEVEL_VARIABLE = "PROG05_LOG_LEVEL";
+
+    /**
+     * @brief Reads the level from the environment and registers the exit and fork handlers.
+     *
+     * @return The least important level that is kept.
+     */
+    static LogLevel initialize();
+
+    /**
+     * @brief Writes the buffers of every log file. The caller holds the lock.
+     */
+    static void flushLocked();
+};
+
 #ifdef DEBUG
 
 /**
@@ -42,18 +122,33 @@ std::string toString(const std::vector<T> &vec)
  * to output debug messages to the console and a file, respectively.
  *
  * DEBUG_CONSOLE(Out): Prints the debug message `Out` to the console if debugging is enabled.
- * DEBUG_FILE(Out, filePath): Writes the debug message `Out` to the specified file if debugging is enabled.
+ * DEBUG_FILE(Out, filePath): Logs the debug message `Out` to the specified file if debugging is enabled.
+ * DEBUG_ERROR(Out, filePath): Same as DEBUG_FILE, for a message about an error.
+ * DEBUG_WARNING(Out, filePath): Same as DEBUG_FILE, for something that was skipped or looks wrong.
+ * DEBUG_LOG(level, Out, filePath): Same as DEBUG_FILE, at the given LogLevel. LogLevel::Debug is
+ * used for the messages logged once per file or per client.
  */
 
-// DEBUG_FILE: Writes the debug message to the specified file, followed by a newline
-#define DEBUG_FILE(message, filePath)                      \
-    {                                                      \
-        std::string debugFilePath = std::string("./Debug/") + filePath; \
-        std::ofstream file(debugFilePath, std::ios::app);  \
-        file << message << std::endl;                      \
-        file.close();                                      \
+// DEBUG_LOG: Adds the debug message to the buffer of the specified file, followed by a newline.
+// The message is formatted into a temporary stream rather than a local variable, so no name
+// used in the message can be hidden by the macro.
+#define DEBUG_LOG(level, message, filePath)                                                    \
+    {                                                                                          \
+        if (DebugLog::isEnabled(level))                                                        \
+        {                                                                                      \
+            DebugLog::write(filePath, (std::ostringstream() << message << '\n').str(), level); \
+        }                                                                                      \
     }
 
+// DEBUG_FILE: Logs the debug message to the specified file, followed by a newline
+#define DEBUG_FILE(message, filePath) DEBUG_LOG(LogLevel::Info, message, filePath)
+
+// DEBUG_ERROR: Logs the error message to the specified file and writes it out right away
+#define DEBUG_ERROR(message, filePath) DEBUG_LOG(LogLevel::Error, message, filePath)
+
+// DEBUG_WARNING: Logs the warning message to the specified file
+#define DEBUG_WARNING(message, filePath) DEBUG_LOG(LogLevel::Warning, message, filePath)
+
 // DEBUG_CONSOLE: Prints the debug message to the console, followed by a newline
 #define DEBUG_CONSOLE(message)             \
     {                                      \
@@ -64,6 +159,9 @@ std::string toString(const std::vector<T> &vec)
 
 #define DEBUG_CONSOLE(...)
 #define DEBUG_FILE(...)
+#define DEBUG_ERROR(...)
+#define DEBUG_WARNING(...)
+#define DEBUG_LOG(...)
 
 #endif // DEBUG
 
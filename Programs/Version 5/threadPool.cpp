@@ -0,0 +1,102 @@
+#include "threadPool.h"
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param numThreads The number of worker threads. At least one thread is started.
+ */
+ThreadPool::ThreadPool(size_t numThreads)
+{
+    numThreads = std::max<size_t>(numThreads, 1);
+    for (size_t i = 0; i < numThreads; i++)
+    {
+        this->workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+/**
+ * @brief Waits for the queued tasks to finish and stops the worker threads.
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->taskAvailable.notify_all();
+
+    for (auto &worker : this->workers)
+    {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Queues a task to be run by one of the worker threads.
+ *
+ * @param task The task to run.
+ */
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->tasks.push(std::move(task));
+        this->activeTasks++;
+    }
+    this->taskAvailable.notify_one();
+}
+
+/**
+ * @brief Blocks until every submitted task has finished running.
+ */
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->allDone.wait(lock, [this]()
+                       { return this->activeTasks == 0; });
+}
+
+/**
+ * @brief Retrieves the number of worker threads.
+ *
+ * @return The number of worker threads.
+ */
+size_t ThreadPool::size() const
+{
+    return this->workers.size();
+}
+
+/**
+ * @brief The loop each worker thread runs, taking tasks off the queue until the pool stops.
+ */
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->taskAvailable.wait(lock, [this]()
+                                     { return this->stopping || !this->tasks.empty(); });
+
+            if (this->tasks.empty())
+            {
+                return; // Stopping and nothing left to run
+            }
+
+            task = std::move(this->tasks.front());
+            this->tasks.pop();
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->activeTasks--;
+            if (this->activeTasks == 0)
+            {
+                this->allDone.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+/**
+ * @brief A fixed-size pool of worker threads that run submitted tasks.
+ *
+ * Tasks are taken from a shared queue in the order they were submitted. The pool is
+ * used by the threaded engine to run each stage of the pipeline for every client
+ * without forking a process per client.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief Starts the worker threads.
+     *
+     * @param numThreads The number of worker threads. At least one thread is started.
+     */
+    ThreadPool(size_t numThreads);
+
+    /**
+     * @brief Waits for the queued tasks to finish and stops the worker threads.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @brief Queues a task to be run by one of the worker threads.
+     *
+     * @param task The task to run.
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief Blocks until every submitted task has finished running.
+     */
+    void wait();
+
+    /**
+     * @brief Retrieves the number of worker threads.
+     *
+     * @return The number of worker threads.
+     */
+    size_t size() const;
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable allDone;
+    size_t activeTasks = 0;
+    bool stopping = false;
+
+    /**
+     * @brief The loop each worker thread runs, taking tasks off the queue until the pool stops.
+     */
+    void workerLoop();
+};
+
+#endif // THREAD_POOL_H
@@ -5,8 +5,6 @@
 // Determines where the executables are located for calling the distributor and processor programs
 std::string EXECUTABLES_PATH = "./Executables/Version 5EC/";
 
-unsigned int PIPE_CAPACITY = 4096;
-
 /**
  * Constructs a client that represents a "distributor" process, whose job is to
  * process a subset of the data files associated with the distributor process.
@@ -330,10 +328,19 @@ void Client::processDataFiles(int writePipeFd)
 
     // Write the sorted lines to the pipe, moving back up the communication chain
     // so the distributor can receive the sorted lines and combine them into a single block of code.
+    // Size the message once, then append each line and its newline without temporaries
+    size_t messageSize = 0;
+    for (const auto &line : lines)
+    {
+        messageSize += line.code.size() + 1;
+    }
+
     std::string message;
+    message.reserve(messageSize);
     for (const auto &line : lines)
     {
-        message += line.code + "\n";
+        message.append(line.code);
+        message.push_back('\n');
     }
 
     // Write the combined message to the pipe
@@ -1,109 +1,236 @@
 #include "communications.h"
 
+#include <memory>
+#include <unordered_map>
+
 /**
- * @brief Reads a message from the specified pipe file descriptor.
+ * The ring buffers mapped by this process, by file descriptor. A null entry marks a file
+ * descriptor that was checked and found to be a pipe.
+ */
+static std::unordered_map<int, std::unique_ptr<RingBuffer>> ringBuffers;
+
+/**
+ * @brief Reads exactly the requested number of bytes from a file descriptor.
  *
- * This function reads a message from the specified pipe file descriptor. The message
- * is expected to be sent in chunks, where each chunk consists of a size followed by
- * the actual data. The function reads the number of chunks first, then reads each
- * chunk and concatenates them to form the complete message.
+ * A single read on a pipe may return fewer bytes than requested, either because the
+ * writer hasn't sent the rest yet or because the call was interrupted. This function
+ * keeps reading until the buffer is full or the pipe is closed.
  *
- * @param readPipeFd The file descriptor for the read end of the pipe.
- * @param debugFile The name of the debug file for logging.
- * @return The complete message read from the pipe.
+ * @param fd The file descriptor to read from.
+ * @param buffer Where to store the bytes.
+ * @param size The number of bytes to read.
+ * @return The number of bytes read, which is less than size only if the pipe was closed,
+ * or -1 on error.
  */
-void writeToPipe(int writePipeFd, const std::string &message, const std::string &debugFile)
+ssize_t readFull(int fd, void *buffer, size_t size)
 {
-    size_t messageSize = message.size();
-    size_t chunks = (messageSize + CHUNCK_LIMIT - 1) / CHUNCK_LIMIT;
+    char *bytes = static_cast<char *>(buffer);
+    size_t total = 0;
 
-    // Write the number of chunks
-    if (write(writePipeFd, &chunks, sizeof(chunks)) == -1)
+    while (total < size)
     {
-        DEBUG_FILE("Failed to write number of chunks to pipe", debugFile);
-        exit(158);
+        ssize_t bytesRead = read(fd, bytes + total, size - total);
+        if (bytesRead == 0)
+        {
+            break; // End of the pipe
+        }
+        else if (bytesRead == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        total += bytesRead;
     }
 
-    // Write each chunk
-    for (size_t i = 0; i < chunks; ++i)
+    return total;
+}
+
+/**
+ * @brief Writes every byte of the given buffers to a file descriptor.
+ *
+ * The buffers are written together with writev, and the call is repeated from wherever
+ * the previous one stopped until everything has been written.
+ *
+ * @param fd The file descriptor to write to.
+ * @param iov The buffers to write, in order. The array is modified as bytes are written.
+ * @param iovcnt The number of buffers.
+ * @return True if every byte was written, false on error.
+ */
+bool writeFull(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0)
     {
-        size_t start = i * CHUNCK_LIMIT;
-        size_t chunkSize = std::min(CHUNCK_LIMIT, messageSize - start);
+        ssize_t bytesWritten = writev(fd, iov, iovcnt);
+        if (bytesWritten == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
 
-        // Write the size of the current chunk
-        if (write(writePipeFd, &chunkSize, sizeof(chunkSize)) == -1)
+        // Skip past the buffers that were written completely, then move the start of
+        // the partially written one forward
+        while (iovcnt > 0 && static_cast<size_t>(bytesWritten) >= iov->iov_len)
         {
-            DEBUG_FILE("Failed to write chunk size to pipe", debugFile);
-            exit(159);
+            bytesWritten -= iov->iov_len;
+            iov++;
+            iovcnt--;
         }
 
-        // Write the actual chunk data
-        if (write(writePipeFd, message.c_str() + start, chunkSize) == -1)
+        if (iovcnt > 0)
         {
-            DEBUG_FILE("Failed to write chunk to pipe", debugFile);
-            exit(160);
+            iov->iov_base = static_cast<char *>(iov->iov_base) + bytesWritten;
+            iov->iov_len -= bytesWritten;
         }
     }
 
-    DEBUG_FILE("Wrote message to pipe: " + message + " in " + std::to_string(chunks) + " chunks", debugFile);
+    return true;
 }
 
 /**
- * @brief Reads a message from the specified pipe file descriptor.
+ * @brief Finds the ring buffer behind a file descriptor, if there is one.
  *
- * This function reads a message from the specified pipe file descriptor. The message
- * is expected to be sent in chunks, where each chunk consists of a size followed by
- * the actual data. The function reads the number of chunks first, then reads each
- * chunk and concatenates them to form the complete message.
+ * The first time a file descriptor is seen, it is checked once and, if it refers to a
+ * ring created by RingBuffer::create, the ring is mapped. The answer is remembered so
+ * later messages don't pay for the check.
  *
- * @param readPipeFd The file descriptor for the read end of the pipe.
+ * @param fd The file descriptor a message is sent or received on.
+ * @return The mapped ring, or nullptr if the file descriptor is a pipe.
+ */
+RingBuffer *getRingBuffer(int fd)
+{
+    auto it = ringBuffers.find(fd);
+    if (it == ringBuffers.end())
+    {
+        std::unique_ptr<RingBuffer> ring;
+        if (RingBuffer::isRingBuffer(fd))
+        {
+            ring = std::make_unique<RingBuffer>(fd);
+        }
+        it = ringBuffers.emplace(fd, std::move(ring)).first;
+    }
+
+    return it->second.get();
+}
+
+/**
+ * @brief Closes a file descriptor used for messages, unmapping its ring buffer if it has one.
+ *
+ * @param fd The file descriptor to close.
+ */
+void closeChannel(int fd)
+{
+    // Forget the file descriptor, since its number may be reused for something else
+    ringBuffers.erase(fd);
+    close(fd);
+}
+
+/**
+ * @brief Writes a message to the specified pipe file descriptor.
+ *
+ * The message is sent as a single frame: its size followed by its contents. Both are
+ * handed to the kernel in one writev call, so a message costs a single system call no
+ * matter how large it is. If the file descriptor is a shared memory ring buffer instead
+ * of a pipe, the frame is copied straight into the ring.
+ *
+ * @param writePipeFd The file descriptor for the write end of the pipe.
+ * @param message The message to send. An empty message is used as a "DONE" signal.
  * @param debugFile The name of the debug file for logging.
- * @return The complete message read from the pipe.
  */
-std::string readFromPipe(int readPipeFd, const std::string &debugFile)
+void writeToPipe(int writePipeFd, const std::string &message, const std::string &debugFile)
 {
-    // Read the number of chunks
-    size_t chunks;
-    ssize_t bytesRead = read(readPipeFd, &chunks, sizeof(chunks));
-    if (bytesRead == 0)
+    size_t messageSize = message.size();
+
+    RingBuffer *ring = getRingBuffer(writePipeFd);
+    if (ring != nullptr)
     {
-        // End of the pipe
-        DEBUG_FILE("Pipe closed", debugFile);
-        return "";
+        if (!ring->write(&messageSize, sizeof(messageSize)) || !ring->write(message.data(), messageSize))
+        {
+            DEBUG_FILE("Failed to write message to ring buffer", debugFile);
+            exit(158);
+        }
+        DEBUG_FILE("Wrote message to ring buffer: " + message, debugFile);
+        return;
     }
-    else if (bytesRead != sizeof(chunks))
+
+    struct iovec iov[2];
+    iov[0].iov_base = &messageSize;
+    iov[0].iov_len = sizeof(messageSize);
+    iov[1].iov_base = const_cast<char *>(message.data());
+    iov[1].iov_len = messageSize;
+
+    if (!writeFull(writePipeFd, iov, 2))
     {
-        // Handle partial read or error
-        DEBUG_FILE("Error reading number of chunks from pipe", debugFile);
+        DEBUG_FILE("Failed to write message to pipe", debugFile);
         exit(158);
     }
 
-    std::string message;
-    message.reserve(chunks * CHUNCK_LIMIT);
+    DEBUG_FILE("Wrote message to pipe: " + message, debugFile);
+}
 
-    for (size_t i = 0; i < chunks; ++i)
+/**
+ * @brief Reads a message from the specified pipe file descriptor.
+ *
+ * The message is expected to be a single frame as sent by writeToPipe. The size is read
+ * first, then the contents are read straight into the returned string. A ring buffer is
+ * never closed, so reading from one returns once a message has arrived or the process on
+ * the other end has exited, which is treated like a closed pipe.
+ *
+ * @param readPipeFd The file descriptor for the read end of the pipe.
+ * @param debugFile The name of the debug file for logging.
+ * @return The complete message read from the pipe, or an empty string if the pipe was closed.
+ */
+std::string readFromPipe(int readPipeFd, const std::string &debugFile)
+{
+    RingBuffer *ring = getRingBuffer(readPipeFd);
+    if (ring != nullptr)
     {
-        // Read the size of the current chunk
-        size_t chunkSize;
-        bytesRead = read(readPipeFd, &chunkSize, sizeof(chunkSize));
-        if (bytesRead != sizeof(chunkSize))
+        size_t messageSize;
+        if (!ring->read(&messageSize, sizeof(messageSize)))
         {
-            DEBUG_FILE("Error reading chunk size from pipe", debugFile);
-            exit(159);
+            // The other end exited without sending anything more
+            DEBUG_FILE("Ring buffer closed", debugFile);
+            return "";
         }
 
-        // Read the actual chunk data
-        std::vector<char> buffer(chunkSize);
-        bytesRead = read(readPipeFd, buffer.data(), chunkSize);
-        if (bytesRead != static_cast<ssize_t>(chunkSize))
+        std::string message(messageSize, '\0');
+        if (!ring->read(message.data(), messageSize))
         {
-            DEBUG_FILE("Error reading chunk data from pipe", debugFile);
+            DEBUG_FILE("Error reading message from ring buffer", debugFile);
             exit(160);
         }
+        return message;
+    }
 
-        message.append(buffer.begin(), buffer.end());
+    // Read the size of the message
+    size_t messageSize;
+    ssize_t bytesRead = readFull(readPipeFd, &messageSize, sizeof(messageSize));
+    if (bytesRead == 0)
+    {
+        // End of the pipe
+        DEBUG_FILE("Pipe closed", debugFile);
+        return "";
+    }
+    else if (bytesRead != sizeof(messageSize))
+    {
+        // Error, or the pipe was closed partway through the size
+        DEBUG_FILE("Error reading message size from pipe", debugFile);
+        exit(159);
+    }
+
+    // Read the contents directly into the message
+    std::string message(messageSize, '\0');
+    bytesRead = readFull(readPipeFd, message.data(), messageSize);
+    if (bytesRead != static_cast<ssize_t>(messageSize))
+    {
+        DEBUG_FILE("Error reading message from pipe", debugFile);
+        exit(160);
     }
 
     return message;
 }
-
@@ -1,35 +1,88 @@
+#ifndef COMMUNICATIONS_H
+#define COMMUNICATIONS_H
+
 #include <vector>
 #include <string>
 #include <fstream>
+#include <cerrno>
 #include <unistd.h>
+#include <sys/uio.h>
 #include "testing.h"
+#include "ringBuffer.h"
 
-const size_t CHUNCK_LIMIT = 64;
+/**
+ * @brief Reads exactly the requested number of bytes from a file descriptor.
+ *
+ * A single read on a pipe may return fewer bytes than requested, either because the
+ * writer hasn't sent the rest yet or because the call was interrupted. This function
+ * keeps reading until the buffer is full or the pipe is closed.
+ *
+ * @param fd The file descriptor to read from.
+ * @param buffer Where to store the bytes.
+ * @param size The number of bytes to read.
+ * @return The number of bytes read, which is less than size only if the pipe was closed,
+ * or -1 on error.
+ */
+ssize_t readFull(int fd, void *buffer, size_t size);
 
 /**
- * @brief Reads a message from the specified pipe file descriptor.
+ * @brief Writes every byte of the given buffers to a file descriptor.
  *
- * This function reads a message from the specified pipe file descriptor. The message
- * is expected to be sent in chunks, where each chunk consists of a size followed by
- * the actual data. The function reads the number of chunks first, then reads each
- * chunk and concatenates them to form the complete message.
+ * The buffers are written together with writev, and the call is repeated from wherever
+ * the previous one stopped until everything has been written.
  *
- * @param readPipeFd The file descriptor for the read end of the pipe.
+ * @param fd The file descriptor to write to.
+ * @param iov The buffers to write, in order. The array is modified as bytes are written.
+ * @param iovcnt The number of buffers.
+ * @return True if every byte was written, false on error.
+ */
+bool writeFull(int fd, struct iovec *iov, int iovcnt);
+
+/**
+ * @brief Finds the ring buffer behind a file descriptor, if there is one.
+ *
+ * The first time a file descriptor is seen, it is checked once and, if it refers to a
+ * ring created by RingBuffer::create, the ring is mapped. The answer is remembered so
+ * later messages don't pay for the check.
+ *
+ * @param fd The file descriptor a message is sent or received on.
+ * @return The mapped ring, or nullptr if the file descriptor is a pipe.
+ */
+RingBuffer *getRingBuffer(int fd);
+
+/**
+ * @brief Closes a file descriptor used for messages, unmapping its ring buffer if it has one.
+ *
+ * @param fd The file descriptor to close.
+ */
+void closeChannel(int fd);
+
+/**
+ * @brief Writes a message to the specified pipe file descriptor.
+ *
+ * The message is sent as a single frame: its size followed by its contents. Both are
+ * handed to the kernel in one writev call, so a message costs a single system call no
+ * matter how large it is. If the file descriptor is a shared memory ring buffer instead
+ * of a pipe, the frame is copied straight into the ring.
+ *
+ * @param writePipeFd The file descriptor for the write end of the pipe.
+ * @param message The message to send. An empty message is used as a "DONE" signal.
  * @param debugFile The name of the debug file for logging.
- * @return The complete message read from the pipe.
  */
 void writeToPipe(int writePipeFd, const std::string &message, const std::string &debugFile);
 
 /**
  * @brief Reads a message from the specified pipe file descriptor.
  *
- * This function reads a message from the specified pipe file descriptor. The message
- * is expected to be sent in chunks, where each chunk consists of a size followed by
- * the actual data. The function reads the number of chunks first, then reads each
- * chunk and concatenates them to form the complete message.
+ * The message is expected to be a single frame as sent by writeToPipe. The size is read
+ * first, then the contents are read straight into the returned string. A ring buffer is
+ * never closed, so reading from one returns once a message has arrived or the process on
+ * the other end has exited, which is treated like a closed pipe.
  *
  * @param readPipeFd The file descriptor for the read end of the pipe.
  * @param debugFile The name of the debug file for logging.
- * @return The complete message read from the pipe.
+ * @return The complete message read from the pipe, or an empty string if the pipe was closed.
  */
 std::string readFromPipe(int readPipeFd, const std::string &debugFile);
+
+#endif // COMMUNICATIONS_H
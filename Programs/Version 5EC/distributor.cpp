@@ -70,8 +70,7 @@ int main(int argc, char *argv[])
     client.verifyDataFilesDistribution(numClients, files, writePipeFd);
 
     // Indicate to the parent process that the client has finished verifying the files
-    size_t doneSignal = 0;
-    write(writePipeFd, &doneSignal, sizeof(doneSignal));
+    writeToPipe(writePipeFd, "", "debug.log");
 
     // Wait until all clients have finished verifying their data files.
     // Server processes a list of data files and sends them to the correct distributor processes.
@@ -9,13 +9,13 @@ int main(int argc, char *argv[])
 {
     if (argc < 4)
     {
-        std::cerr << "Usage: " << argv[0] << " <highestProcessIdx> <dataFolder> <outputFile>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <highestProcessIdx> <dataFolder> <outputFile> [--transport=pipes|rings]" << std::endl;
         return 26;
     }
 
-    else if (argc > 4)
+    else if (argc > 5)
     {
-        std::cerr << "Usage: " << argv[0] << " <highestProcessIdx> <dataFolder> <outputFile>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <highestProcessIdx> <dataFolder> <outputFile> [--transport=pipes|rings]" << std::endl;
         return 27;
     }
 
@@ -31,6 +31,23 @@ int main(int argc, char *argv[])
     // Third argument contains the path to the output file
     std::string outputFile = argv[3];
 
+    // Optional fourth argument selects how the server and the distributors talk: pipes (the
+    // default), or ring buffers in shared memory that avoid a system call per message
+    bool useRingBuffers = false;
+    if (argc == 5)
+    {
+        std::string option = argv[4];
+        if (option == "--transport=rings")
+        {
+            useRingBuffers = true;
+        }
+        else if (option != "--transport=pipes")
+        {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 28;
+        }
+    }
+
 #ifdef DEBUG
     // Clear the debug folder of old logs
     std::filesystem::remove_all("./Debug");
@@ -46,7 +63,7 @@ int main(int argc, char *argv[])
     // line of code itself.
 
     // Launch the server process
-    Server server(numClients);
+    Server server(numClients, useRingBuffers);
 
     // Get all the data files from the specified folder and distribute them among the clients
     std::vector<std::string> dataFiles = server.getAllDataFiles(dataFolder);
@@ -62,7 +79,7 @@ int main(int argc, char *argv[])
     // It will finally combine the lines back into a block of code.
     // This step is handeled by the client distributor process, not the server.
 
-    std::string reconstructedCode = server.initializeDistributor(dataFiles);
+    std::vector<std::string> reconstructedCode = server.initializeDistributor(dataFiles);
 
     // Lastly, the server outputs the reconstructed program to a file.
     server.writeOutputFile(outputFile, reconstructedCode);
@@ -0,0 +1,292 @@
+#include "ringBuffer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <climits>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+/**
+ * Identifies a memory file as a ring, so a ring can be told apart from other regular files.
+ */
+static const uint64_t RING_MAGIC = 0x474e495235454356; // "VCE5RING"
+
+/**
+ * @brief Creates a new, empty ring in a memory file.
+ *
+ * The returned file descriptor is not close-on-exec so it can be handed to the
+ * distributor and processor programs. The creator marks its own copy close-on-exec
+ * once the child it is meant for has been forked.
+ *
+ * @param capacity The number of bytes the ring can hold, which must be a power of two.
+ * @return The file descriptor of the memory file.
+ */
+int RingBuffer::create(size_t capacity)
+{
+    size_t totalSize = sizeof(Header) + capacity;
+
+    int fd = memfd_create("ring", 0);
+    if (fd == -1 || ftruncate(fd, totalSize) == -1)
+    {
+        perror("Creating ring buffer failed");
+        exit(190);
+    }
+
+    void *mapped = mmap(nullptr, sizeof(Header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        perror("Mapping ring buffer failed");
+        exit(191);
+    }
+
+    Header *header = new (mapped) Header();
+    header->magic = RING_MAGIC;
+    header->capacity = capacity;
+    header->ownerPid = getpid();
+
+    munmap(mapped, sizeof(Header));
+    return fd;
+}
+
+/**
+ * @brief Checks whether a file descriptor refers to a ring created by RingBuffer::create.
+ *
+ * @param fd The file descriptor to check.
+ * @return True if the file descriptor is a ring, false if it is anything else (such as a pipe).
+ */
+bool RingBuffer::isRingBuffer(int fd)
+{
+    struct stat info;
+    if (fstat(fd, &info) == -1 || !S_ISREG(info.st_mode) || static_cast<size_t>(info.st_size) < sizeof(Header))
+    {
+        return false;
+    }
+
+    uint64_t magic;
+    return pread(fd, &magic, sizeof(magic), 0) == sizeof(magic) && magic == RING_MAGIC;
+}
+
+/**
+ * @brief Maps a ring created by RingBuffer::create.
+ *
+ * @param fd The file descriptor of the memory file.
+ */
+RingBuffer::RingBuffer(int fd)
+{
+    struct stat info;
+    if (fstat(fd, &info) == -1)
+    {
+        perror("Reading ring buffer size failed");
+        exit(192);
+    }
+
+    this->mappedSize = info.st_size;
+    void *mapped = mmap(nullptr, this->mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        perror("Mapping ring buffer failed");
+        exit(193);
+    }
+
+    this->header = static_cast<Header *>(mapped);
+    this->data = static_cast<char *>(mapped) + sizeof(Header);
+}
+
+/**
+ * @brief Unmaps the ring. The file descriptor is left open.
+ */
+RingBuffer::~RingBuffer()
+{
+    munmap(this->header, this->mappedSize);
+}
+
+/**
+ * @brief Records the child process on the other end of the ring.
+ *
+ * Only the process that created the ring calls this, right after forking the child.
+ *
+ * @param pid The process ID of the child.
+ */
+void RingBuffer::setPeer(pid_t pid)
+{
+    this->header->peerPid.store(pid);
+}
+
+/**
+ * @brief Writes every byte of the buffer to the ring, waiting for space as needed.
+ *
+ * @param buffer The bytes to write.
+ * @param size The number of bytes to write.
+ * @return True if every byte was written, false if the other end exited while the ring was full.
+ */
+bool RingBuffer::write(const void *buffer, size_t size)
+{
+    const char *bytes = static_cast<const char *>(buffer);
+    uint64_t capacity = this->header->capacity;
+    bool peerAlive = true;
+
+    while (size > 0)
+    {
+        uint64_t writePos = this->header->writePos.load(std::memory_order_relaxed);
+        uint64_t space = capacity - (writePos - this->header->readPos.load(std::memory_order_acquire));
+
+        if (space == 0)
+        {
+            if (!peerAlive)
+            {
+                return false;
+            }
+
+            // Announce that the writer is waiting before checking one last time, so the
+            // reader either sees the flag or the writer sees the space it freed
+            uint32_t seq = this->header->readSeq.load();
+            this->header->writerWaiting.store(1);
+            if (capacity - (writePos - this->header->readPos.load()) == 0)
+            {
+                peerAlive = this->waitOn(this->header->readSeq, seq);
+            }
+            this->header->writerWaiting.store(0, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Copy as much as fits before the end of the data, the rest goes on the next pass
+        size_t offset = writePos & (capacity - 1);
+        size_t chunk = std::min<uint64_t>({size, space, capacity - offset});
+        std::memcpy(this->data + offset, bytes, chunk);
+
+        this->header->writePos.store(writePos + chunk);
+        RingBuffer::notify(this->header->writeSeq, this->header->readerWaiting);
+
+        bytes += chunk;
+        size -= chunk;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Reads exactly the requested number of bytes from the ring, waiting for data as needed.
+ *
+ * @param buffer Where to store the bytes.
+ * @param size The number of bytes to read.
+ * @return True if every byte was read, false if the other end exited before sending them.
+ */
+bool RingBuffer::read(void *buffer, size_t size)
+{
+    char *bytes = static_cast<char *>(buffer);
+    uint64_t capacity = this->header->capacity;
+    bool peerAlive = true;
+
+    while (size > 0)
+    {
+        uint64_t readPos = this->header->readPos.load(std::memory_order_relaxed);
+        uint64_t available = this->header->writePos.load(std::memory_order_acquire) - readPos;
+
+        if (available == 0)
+        {
+            // Whatever the other end wrote before exiting has been read by now
+            if (!peerAlive)
+            {
+                return false;
+            }
+
+            // Same handshake as the writer, with the roles swapped
+            uint32_t seq = this->header->writeSeq.load();
+            this->header->readerWaiting.store(1);
+            if (this->header->writePos.load() == readPos)
+            {
+                peerAlive = this->waitOn(this->header->writeSeq, seq);
+            }
+            this->header->readerWaiting.store(0, std::memory_order_relaxed);
+            continue;
+        }
+
+        size_t offset = readPos & (capacity - 1);
+        size_t chunk = std::min<uint64_t>({size, available, capacity - offset});
+        std::memcpy(bytes, this->data + offset, chunk);
+
+        this->header->readPos.store(readPos + chunk);
+        RingBuffer::notify(this->header->readSeq, this->header->writerWaiting);
+
+        bytes += chunk;
+        size -= chunk;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Blocks until the counter changes from the given value or the wait is cut short.
+ *
+ * The futex is shared between processes, since the ring is mapped from the same memory
+ * file in each of them. The caller re-checks the ring after every return. The wait is
+ * bounded so a process that crashed without a word doesn't leave the other end waiting
+ * forever.
+ *
+ * @param seq The counter to wait on.
+ * @param expected The value the caller last saw.
+ * @return False if the wait timed out and the other end has exited, true otherwise.
+ */
+bool RingBuffer::waitOn(std::atomic<uint32_t> &seq, uint32_t expected) const
+{
+    struct timespec timeout = {0, WAIT_TIMEOUT_NS};
+    if (syscall(SYS_futex, reinterpret_cast<uint32_t *>(&seq), FUTEX_WAIT, expected, &timeout, nullptr, 0) == -1 &&
+        errno == ETIMEDOUT)
+    {
+        return this->isPeerAlive();
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks whether the process on the other end of the ring is still running.
+ *
+ * The creator checks on its child without reaping it, so the child can still be waited
+ * for as usual. Every other process checks on the creator.
+ *
+ * @return True if the other end may still use the ring, false if it has exited.
+ */
+bool RingBuffer::isPeerAlive() const
+{
+    if (this->header->ownerPid != getpid())
+    {
+        return kill(this->header->ownerPid, 0) == 0;
+    }
+
+    pid_t peer = this->header->peerPid.load();
+    if (peer == 0)
+    {
+        return true;
+    }
+
+    siginfo_t info = {};
+    return waitid(P_PID, peer, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == 0;
+}
+
+/**
+ * @brief Bumps the counter and wakes the other side if it is waiting on it.
+ *
+ * The system call is only made when the other side has announced it is waiting, so a
+ * steady stream of messages never enters the kernel.
+ *
+ * @param seq The counter to bump.
+ * @param waiting The other side's waiting flag.
+ */
+void RingBuffer::notify(std::atomic<uint32_t> &seq, std::atomic<uint32_t> &waiting)
+{
+    seq.fetch_add(1);
+    if (waiting.load())
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&seq), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+}
@@ -0,0 +1,164 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+/**
+ * @brief A single-producer, single-consumer byte stream in shared memory.
+ *
+ * The ring lives in a memory file so it can be handed to the distributor and processor
+ * programs through a file descriptor, exactly like a pipe: an anonymous shared mapping
+ * would not survive exec. Both ends map the same memory file, copy bytes in and out of it
+ * directly, and only enter the kernel (through a futex on a counter in the ring) when the
+ * ring is full or empty and the other side has to be woken up.
+ *
+ * Only one process may write to a ring and only one may read from it at any time.
+ *
+ * A ring is never closed like a pipe, so a side that is waiting wakes up every so often
+ * to check that the process on the other end is still running. The process that created
+ * the ring watches the child it was handed to, and every other process watches the creator.
+ */
+class RingBuffer
+{
+public:
+    /**
+     * The number of bytes a ring can hold before the writer has to wait.
+     */
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 18;
+
+    /**
+     * @brief Creates a new, empty ring in a memory file.
+     *
+     * The returned file descriptor is not close-on-exec so it can be handed to the
+     * distributor and processor programs. The creator marks its own copy close-on-exec
+     * once the child it is meant for has been forked.
+     *
+     * @param capacity The number of bytes the ring can hold, which must be a power of two.
+     * @return The file descriptor of the memory file.
+     */
+    static int create(size_t capacity);
+
+    /**
+     * @brief Checks whether a file descriptor refers to a ring created by RingBuffer::create.
+     *
+     * @param fd The file descriptor to check.
+     * @return True if the file descriptor is a ring, false if it is anything else (such as a pipe).
+     */
+    static bool isRingBuffer(int fd);
+
+    /**
+     * @brief Maps a ring created by RingBuffer::create.
+     *
+     * @param fd The file descriptor of the memory file.
+     */
+    RingBuffer(int fd);
+
+    /**
+     * @brief Unmaps the ring. The file descriptor is left open.
+     */
+    ~RingBuffer();
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    /**
+     * @brief Records the child process on the other end of the ring.
+     *
+     * Only the process that created the ring calls this, right after forking the child.
+     *
+     * @param pid The process ID of the child.
+     */
+    void setPeer(pid_t pid);
+
+    /**
+     * @brief Writes every byte of the buffer to the ring, waiting for space as needed.
+     *
+     * @param buffer The bytes to write.
+     * @param size The number of bytes to write.
+     * @return True if every byte was written, false if the other end exited while the ring was full.
+     */
+    bool write(const void *buffer, size_t size);
+
+    /**
+     * @brief Reads exactly the requested number of bytes from the ring, waiting for data as needed.
+     *
+     * @param buffer Where to store the bytes.
+     * @param size The number of bytes to read.
+     * @return True if every byte was read, false if the other end exited before sending them.
+     */
+    bool read(void *buffer, size_t size);
+
+private:
+    /**
+     * @struct Header
+     * @brief The shared state at the start of the memory file, followed by the data.
+     *
+     * The positions only ever grow; the offset into the data is the position modulo the
+     * capacity. The writer and reader fields are kept on separate cache lines so the two
+     * processes don't fight over the same line on every update.
+     */
+    struct Header
+    {
+        uint64_t magic;
+        uint64_t capacity;
+        int32_t ownerPid;
+        std::atomic<int32_t> peerPid;
+
+        alignas(64) std::atomic<uint64_t> writePos;
+        std::atomic<uint32_t> writeSeq;
+        std::atomic<uint32_t> readerWaiting;
+
+        alignas(64) std::atomic<uint64_t> readPos;
+        std::atomic<uint32_t> readSeq;
+        std::atomic<uint32_t> writerWaiting;
+    };
+
+    /**
+     * The header at the start of the mapped memory file.
+     */
+    Header *header;
+
+    /**
+     * The ring's data, right after the header.
+     */
+    char *data;
+
+    /**
+     * The size of the mapped memory file.
+     */
+    size_t mappedSize;
+
+    /**
+     * How long a side waits on the futex before checking that the other end is still running.
+     */
+    static constexpr long WAIT_TIMEOUT_NS = 100 * 1000 * 1000;
+
+    /**
+     * @brief Blocks until the counter changes from the given value or the wait is cut short.
+     *
+     * @param seq The counter to wait on.
+     * @param expected The value the caller last saw.
+     * @return False if the wait timed out and the other end has exited, true otherwise.
+     */
+    bool waitOn(std::atomic<uint32_t> &seq, uint32_t expected) const;
+
+    /**
+     * @brief Checks whether the process on the other end of the ring is still running.
+     *
+     * @return True if the other end may still use the ring, false if it has exited.
+     */
+    bool isPeerAlive() const;
+
+    /**
+     * @brief Bumps the counter and wakes the other side if it is waiting on it.
+     *
+     * @param seq The counter to bump.
+     * @param waiting The other side's waiting flag.
+     */
+    static void notify(std::atomic<uint32_t> &seq, std::atomic<uint32_t> &waiting);
+};
+
+#endif // RING_BUFFER_H
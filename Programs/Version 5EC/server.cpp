@@ -9,10 +9,13 @@
  * client objects.
  *
  * @param numClients The number of clients to be managed by the server.
+ * @param useRingBuffers Whether to talk to the distributors over shared memory ring
+ * buffers instead of pipes.
  */
-Server::Server(int numClients)
+Server::Server(int numClients, bool useRingBuffers)
 {
     this->numClients = numClients;
+    this->useRingBuffers = useRingBuffers;
     std::vector<Client> clients;
     for (int i = 0; i < numClients; i++)
     {
@@ -91,8 +94,9 @@ std::vector<std::string> Server::getAllDataFiles(const std::string &folderPath)
  * processes to complete verification and then signals them to proceed wiith processing.
  *
  * @param files A vector of strings representing the data files to be verified.
+ * @return The blocks of code of every client, in client order.
  */
-std::string Server::initializeDistributor(const std::vector<std::string> &files)
+std::vector<std::string> Server::initializeDistributor(const std::vector<std::string> &files)
 {
     // Create pipes for each child
     std::vector<int> childToParentPipes(numClients);
@@ -107,7 +111,14 @@ std::string Server::initializeDistributor(const std::vector<std::string> &files)
         int pipeChildToParent[2]; // [0] = read, [1] = write
         int pipeParentToChild[2]; // [0] = read, [1] = write
 
-        if (pipe(pipeChildToParent) == -1 || pipe(pipeParentToChild) == -1)
+        if (this->useRingBuffers)
+        {
+            // A ring is a single memory file that both ends map, so the same file
+            // descriptor serves as the read and the write end
+            pipeChildToParent[0] = pipeChildToParent[1] = RingBuffer::create(RingBuffer::DEFAULT_CAPACITY);
+            pipeParentToChild[0] = pipeParentToChild[1] = RingBuffer::create(RingBuffer::DEFAULT_CAPACITY);
+        }
+        else if (pipe(pipeChildToParent) == -1 || pipe(pipeParentToChild) == -1)
         {
             std::cerr << "Creating pipes failed" << std::endl;
             exit(150);
@@ -117,8 +128,11 @@ std::string Server::initializeDistributor(const std::vector<std::string> &files)
         if (pid == 0)
         {
             // Child process
-            close(pipeChildToParent[0]); // Close read end of child-to-parent pipe
-            close(pipeParentToChild[1]); // Close write end of parent-to-child pipe
+            if (!this->useRingBuffers)
+            {
+                close(pipeChildToParent[0]); // Close read end of child-to-parent pipe
+                close(pipeParentToChild[1]); // Close write end of parent-to-child pipe
+            }
 
             // Pass the client's index, the write end of the child to parent pipe,
             // the read end of the parent to child pipe, and the list of files to the child process
@@ -132,8 +146,20 @@ std::string Server::initializeDistributor(const std::vector<std::string> &files)
             childToParentPipes[i] = pipeChildToParent[0]; // Read end of child-to-parent pipe (for receiving signals)
             parentToChildPipes[i] = pipeParentToChild[1]; // Write end of parent-to-child pipe (for sending signals)
 
-            close(pipeChildToParent[1]); // Close write end in parent
-            close(pipeParentToChild[0]); // Close read end in parent
+            if (!this->useRingBuffers)
+            {
+                close(pipeChildToParent[1]); // Close write end in parent
+                close(pipeParentToChild[0]); // Close read end in parent
+            }
+            else
+            {
+                // Keep the server's copies out of the distributors forked after this one,
+                // and let the rings notice if this distributor exits without a word
+                fcntl(pipeChildToParent[0], F_SETFD, FD_CLOEXEC);
+                fcntl(pipeParentToChild[1], F_SETFD, FD_CLOEXEC);
+                getRingBuffer(pipeChildToParent[0])->setPeer(pid);
+                getRingBuffer(pipeParentToChild[1])->setPeer(pid);
+            }
         }
         else
         {
@@ -151,8 +177,12 @@ std::string Server::initializeDistributor(const std::vector<std::string> &files)
     // Redistribute any incorrectly distributed files by sending them to the correct clients
     this->redistributeDataFiles(incorrectlyDistributedFiles, parentToChildPipes);
 
-    // Distributor process do some work, create their own children, process data, etc
-    // Wait for all child processes to finish processing the data files
+    // Distributor process do some work, create their own children, process data, etc.
+    // Retrieve the code blocks sent by the children while they are still running, so a
+    // block larger than the pipe buffer doesn't leave a processor blocked on a full pipe.
+    std::vector<std::string> combinedResults = this->collectProcessedDataResults(childToParentPipes);
+
+    // Every child has sent its result, so reap them now
     for (int i = 0; i < this->numClients; i++)
     {
         int status;
@@ -161,18 +191,15 @@ std::string Server::initializeDistributor(const std::vector<std::string> &files)
 
     DEBUG_FILE("Finished distributing and processing data files.", "debug.log");
 
-    // Children have finsihed processing the data files since they've terminated.
-    // Now We can retrieve the code blocks sent by the children.
-    std::vector<std::string> combinedResults = this->collectProcessedDataResults(childToParentPipes);
-
     // Close pipes
     for (int i = 0; i < this->numClients; i++)
     {
-        close(childToParentPipes[i]);
+        closeChannel(childToParentPipes[i]);
+        closeChannel(parentToChildPipes[i]);
     }
 
-    // Concatenate the combined results from all clients
-    return std::accumulate(combinedResults.begin(), combinedResults.end(), std::string());
+    // The blocks are written out in client order without being concatenated first
+    return combinedResults;
 }
 
 /**
@@ -294,7 +321,9 @@ std::vector<std::vector<std::string>> Server::awaitDistributorProcesses(std::vec
  * This function iterates over a list of incorrectly distributed files for each client
  * and sends the file paths to the respective clients through pipes. It also sends an
  * ending signal to indicate that the redistribution is complete so that the distributor
- * can immediately resume and process the data files.
+ * can immediately resume and process the data files. The ending signal is sent to every
+ * client, even one with no files to receive, since a distributor waits for it before
+ * processing (a ring buffer, unlike a pipe, is never closed underneath it).
  *
  * Each inner vector in incorrectlyDistributedFiles corresponds to a specific client.
  * The function writes the size of each file path followed by the actual file path
@@ -311,12 +340,6 @@ void Server::redistributeDataFiles(const std::vector<std::vector<std::string>> &
     // Iterate over all clients
     for (size_t i = 0; i < incorrectlyDistributedFiles.size(); ++i)
     {
-        // Skip if there are no incorrectly distributed files for this client
-        if (incorrectlyDistributedFiles[i].empty())
-        {
-            continue;
-        }
-
         // Iterate over files that need to be redistributed to client `i`
         for (const auto &file : incorrectlyDistributedFiles[i])
         {
@@ -364,15 +387,16 @@ std::vector<std::string> Server::collectProcessedDataResults(std::vector<int> &c
 }
 
 /**
- * @brief Writes the given content to the specified output file.
+ * @brief Writes the given blocks of code to the specified output file, in order.
  *
- * This function attempts to open the specified output file and write the provided
- * content to it. If the file cannot be opened, an error message is printed to std::cerr.
+ * The blocks are handed to the kernel as a list of buffers with writev, so they are
+ * written without first being copied into one string. If the file cannot be opened,
+ * an error message is printed to std::cerr.
  *
  * @param outputFile The path to the output file where the content will be written.
- * @param content The content to be written to the output file.
+ * @param blocks The blocks of code to be written to the output file.
  */
-void Server::writeOutputFile(const std::string &outputFile, const std::string &content)
+void Server::writeOutputFile(const std::string &outputFile, const std::vector<std::string> &blocks)
 {
     std::string finalOutputFile = outputFile;
     if (finalOutputFile.substr(finalOutputFile.find_last_of(".") + 1) != "c")
@@ -380,14 +404,32 @@ void Server::writeOutputFile(const std::string &outputFile, const std::string &c
         finalOutputFile += ".c";
     }
 
-    std::ofstream file(finalOutputFile);
-    if (file.is_open())
+    int fd = open(finalOutputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
     {
-        file << content;
-        file.close();
+        std::cerr << "Error opening output file: " << finalOutputFile << std::endl;
+        return;
     }
-    else
+
+    std::vector<struct iovec> iov;
+    for (const auto &block : blocks)
     {
-        std::cerr << "Error opening output file: " << finalOutputFile << std::endl;
+        if (!block.empty())
+        {
+            iov.push_back({const_cast<char *>(block.data()), block.size()});
+        }
     }
+
+    // A single writev call takes at most IOV_MAX buffers
+    for (size_t i = 0; i < iov.size(); i += IOV_MAX)
+    {
+        int iovcnt = std::min<size_t>(iov.size() - i, IOV_MAX);
+        if (!writeFull(fd, iov.data() + i, iovcnt))
+        {
+            std::cerr << "Error writing output file: " << finalOutputFile << std::endl;
+            break;
+        }
+    }
+
+    close(fd);
 }
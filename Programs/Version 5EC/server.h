@@ -9,6 +9,9 @@
 #include <unistd.h>
 #include <sys/wait.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <sys/uio.h>
 #include "client.h"
 
 class Server
@@ -21,8 +24,10 @@ public:
      * client objects.
      *
      * @param numClients The number of clients to be managed by the server.
+     * @param useRingBuffers Whether to talk to the distributors over shared memory ring
+     * buffers instead of pipes.
      */
-    Server(int numClients);
+    Server(int numClients, bool useRingBuffers);
 
     /**
      * @brief Distributes a list of data files evenly among the clients.
@@ -57,23 +62,26 @@ public:
      * processes to complete verification and then signals them to proceed wiith processing.
      *
      * @param files A vector of strings representing the data files to be verified.
+     * @return The blocks of code of every client, in client order.
      */
-    std::string initializeDistributor(const std::vector<std::string> &files);
+    std::vector<std::string> initializeDistributor(const std::vector<std::string> &files);
 
     /**
-     * @brief Writes the given content to the specified output file.
+     * @brief Writes the given blocks of code to the specified output file, in order.
      *
-     * This function attempts to open the specified output file and write the provided
-     * content to it. If the file cannot be opened, an error message is printed to std::cerr.
+     * The blocks are handed to the kernel as a list of buffers with writev, so they are
+     * written without first being copied into one string. If the file cannot be opened,
+     * an error message is printed to std::cerr.
      *
      * @param outputFile The path to the output file where the content will be written.
-     * @param content The content to be written to the output file.
+     * @param blocks The blocks of code to be written to the output file.
      */
-    void writeOutputFile(const std::string &outputFile, const std::string &content);
+    void writeOutputFile(const std::string &outputFile, const std::vector<std::string> &blocks);
 
 private:
     std::vector<Client> clients;
     int numClients;
+    bool useRingBuffers;
 
     /**
      * @brief Runs the distributor child process for a specific client.
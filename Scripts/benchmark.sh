@@ -0,0 +1,15 @@
+# Get command line arguments
+if [ "$#" -lt 1 ]; then
+    echo "Usage: $0 <report_file> [--reps=N] [--versions=1,2,3,4,5,5EC] [--data=<data_folder>]..."
+    exit 1
+fi
+
+# Every version is launched from the root of the project, so their executables have
+# to be built first (see build.sh)
+if [ ! -x ./Executables/Benchmark/benchmark ]; then
+    echo "Benchmark executable does not exist"
+    exit 2
+fi
+
+# Run every version on the data sets and write the results to the report as JSON
+./Executables/Benchmark/benchmark "$@"
@@ -2,6 +2,8 @@ path3="./Programs/Version 3/"
 path4="./Programs/Version 4/"
 path5="./Programs/Version 5/"
 path6="./Programs/Version 5EC/"
+pathBench="./Programs/Benchmark/"
+pathGen="./Programs/Generator/"
 debug_flag=""
 
 if [ "$1" == "debug" ]; then
@@ -13,8 +15,10 @@ fi
 # mkdir -p ./Executables/Version\ 2
 # mkdir -p ./Executables/Version\ 3
 # mkdir -p ./Executables/Version\ 4
-# mkdir -p ./Executables/Version\ 5
+mkdir -p ./Executables/Version\ 5
 # mkdir -p ./Executables/Version\ 5EC
+mkdir -p ./Executables/Benchmark
+mkdir -p ./Executables/Generator
 
 # g++ -Wall -std=c++20 $debug_flag ./Programs/Version\ 1/*.cpp -o ./Executables/Version\ 1/version1
 # g++ -Wall -std=c++20 $debug_flag ./Programs/Version\ 2/*.cpp -o ./Executables/Version\ 2/version2
@@ -27,10 +31,14 @@ fi
 # g++ -Wall -std=c++20 $debug_flag "${path4}distributor.cpp" "${path4}client.cpp" "${path4}testing.cpp" -o ./Executables/Version\ 4/distributor
 # g++ -Wall -std=c++20 $debug_flag "${path4}processor.cpp" "${path4}client.cpp" "${path4}testing.cpp" -o ./Executables/Version\ 4/processor
 
-# g++ -Wall -std=c++20 $debug_flag "${path5}main.cpp" "${path5}server.cpp" "${path5}client.cpp" "${path5}testing.cpp" -o ./Executables/Version\ 5/version5
-# g++ -Wall -std=c++20 $debug_flag "${path5}distributor.cpp" "${path5}client.cpp" "${path5}testing.cpp" -o ./Executables/Version\ 5/distributor
-# g++ -Wall -std=c++20 $debug_flag "${path5}processor.cpp" "${path5}client.cpp" "${path5}testing.cpp" -o ./Executables/Version\ 5/processor
+g++ -Wall -std=c++20 $debug_flag "${path5}main.cpp" "${path5}server.cpp" "${path5}threadPool.cpp" "${path5}client.cpp" "${path5}fragmentReader.cpp" "${path5}fragmentParser.cpp" "${path5}fragmentTable.cpp" "${path5}fragmentPack.cpp" "${path5}phaseTimer.cpp" "${path5}manifest.cpp" "${path5}communications.cpp" "${path5}testing.cpp" -o ./Executables/Version\ 5/version5
+g++ -Wall -std=c++20 $debug_flag "${path5}distributor.cpp" "${path5}client.cpp" "${path5}fragmentReader.cpp" "${path5}fragmentParser.cpp" "${path5}fragmentTable.cpp" "${path5}phaseTimer.cpp" "${path5}manifest.cpp" "${path5}communications.cpp" "${path5}testing.cpp" -o ./Executables/Version\ 5/distributor
+g++ -Wall -std=c++20 $debug_flag "${path5}processor.cpp" "${path5}client.cpp" "${path5}fragmentReader.cpp" "${path5}fragmentParser.cpp" "${path5}fragmentTable.cpp" "${path5}phaseTimer.cpp" "${path5}manifest.cpp" "${path5}communications.cpp" "${path5}testing.cpp" -o ./Executables/Version\ 5/processor
+g++ -Wall -std=c++20 $debug_flag "${path5}pack.cpp" "${path5}fragmentPack.cpp" "${path5}fragmentReader.cpp" "${path5}fragmentParser.cpp" "${path5}fragmentTable.cpp" -o ./Executables/Version\ 5/pack
 
-g++ -Wall -std=c++20 $debug_flag "${path6}main.cpp" "${path6}server.cpp" "${path6}client.cpp" "${path6}communications.cpp" -o ./Executables/Version\ 5EC/version5EC
-g++ -Wall -std=c++20 $debug_flag "${path6}distributor.cpp" "${path6}client.cpp" "${path6}communications.cpp" -o ./Executables/Version\ 5EC/distributor
-g++ -Wall -std=c++20 $debug_flag "${path6}processor.cpp" "${path6}client.cpp" "${path6}communications.cpp" -o ./Executables/Version\ 5EC/processor
+g++ -Wall -std=c++20 $debug_flag "${path6}main.cpp" "${path6}server.cpp" "${path6}client.cpp" "${path6}communications.cpp" "${path6}ringBuffer.cpp" -o ./Executables/Version\ 5EC/version5EC
+g++ -Wall -std=c++20 $debug_flag "${path6}distributor.cpp" "${path6}client.cpp" "${path6}communications.cpp" "${path6}ringBuffer.cpp" -o ./Executables/Version\ 5EC/distributor
+g++ -Wall -std=c++20 $debug_flag "${path6}processor.cpp" "${path6}client.cpp" "${path6}communications.cpp" "${path6}ringBuffer.cpp" -o ./Executables/Version\ 5EC/processor
+
+g++ -Wall -std=c++20 $debug_flag "${pathBench}main.cpp" "${pathBench}benchmark.cpp" -o ./Executables/Benchmark/benchmark
+g++ -Wall -std=c++20 $debug_flag "${pathGen}main.cpp" "${pathGen}generator.cpp" -o ./Executables/Generator/generator
@@ -0,0 +1,16 @@
+# Get command line arguments
+if [ "$#" -lt 2 ]; then
+    echo "Usage: $0 <source_file> <output_folder> [--fragments=N] [--procs=N] [--skew=S] [--line-length=source|fixed:N|uniform:MIN:MAX|normal:MEAN:STDDEV] [--crlf=FRACTION] [--seed=N]"
+    exit 1
+fi
+
+source_file=$1
+
+# Check if the source file exists
+if [ ! -f "$source_file" ]; then
+    echo "Source file does not exist"
+    exit 2
+fi
+
+# Split the source file into a folder of data files, one fragment per file
+./Executables/Generator/generator "$@"
@@ -0,0 +1,17 @@
+# Get command line arguments
+if [ "$#" -ne 2 ]; then
+    echo "Usage: $0 <data_folder> <pack_file>"
+    exit 1
+fi
+
+data_folder=$1
+pack_file=$2
+
+# Check if the data folder exists
+if [ ! -d "$data_folder" ]; then
+    echo "Data folder does not exist"
+    exit 2
+fi
+
+# Pack every data file into one file that script05.sh takes in place of the folder
+./Executables/Version\ 5/pack "$data_folder" "$pack_file"
@@ -1,6 +1,6 @@
 # Get command line arguments
-if [ "$#" -ne 2 ]; then
-    echo "Usage: $0 <data_folder> <output_file>"
+if [ "$#" -lt 2 ] || [ "$#" -gt 3 ]; then
+    echo "Usage: $0 <data_folder> <output_file> [--transport=pipes|rings]"
     exit 1
 fi
 
@@ -25,5 +25,5 @@ done
 
 echo "Launching server process with $((highest_process_idx + 1)) processes"
 
-# Launch the server process
-./Executables/Version\ 5EC/version5EC $highest_process_idx $data_folder $output_file
+# Launch the server process, passing along the transport option if there is one
+./Executables/Version\ 5EC/version5EC $highest_process_idx $data_folder $output_file "${@:3}"